@@ -39,6 +39,7 @@
 #include "DepthWaves.h"
 
 #include "GL_base.h"
+#include "DepthWaves_Profile.h"
 #include "Smart_Utils.h"
 #include "AEFX_SuiteHelper.h"
 
@@ -46,7 +47,21 @@
 #include <atomic>
 #include <map>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <utility>
 #include <assert.h>
+#include <stdlib.h>
+#include <errno.h>
+#ifndef AE_OS_WIN
+#include <sys/stat.h>
+#endif
 
 using namespace AESDK_OpenGL;
 using namespace gl45core;
@@ -57,6 +72,101 @@ using namespace gl45core;
 /* AESDK_OpenGL effect specific variables */
 
 namespace {
+	// Threads started once at GlobalSetup and shared by every render thread, so CPU work split
+	// across cores neither starts threads per frame nor multiplies them under multi-frame
+	// rendering. A caller runs its own jobs too, which keeps it moving however busy the workers are.
+	class WorkerPool
+	{
+	public:
+		explicit WorkerPool(unsigned numWorkers) :
+			mStopping(false)
+		{
+			for (unsigned i = 0; i < numWorkers; ++i) {
+				mWorkers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+			}
+		}
+
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+			mWork.notify_all();
+			for (size_t i = 0; i < mWorkers.size(); ++i) {
+				mWorkers[i].join();
+			}
+		}
+
+		// the workers and the caller
+		int GetNumThreads() const
+		{
+			return static_cast<int>(mWorkers.size()) + 1;
+		}
+
+		// call job(0) .. job(numJobs - 1) across the pool, returning once all of them have
+		void Run(int numJobs, const std::function<void(int)>& job)
+		{
+			std::shared_ptr<Batch> batch(new Batch(job, numJobs));
+			std::unique_lock<std::mutex> lock(mMutex);
+			mBatches.push_back(batch);
+			mWork.notify_all();
+
+			while (batch->nextJob < batch->numJobs) {
+				RunJob(batch, lock);
+			}
+			batch->done.wait(lock, [&batch] { return batch->unfinished == 0; });
+		}
+
+	private:
+		struct Batch {
+			Batch(const std::function<void(int)>& inJob, int inNumJobs) :
+				job(inJob), numJobs(inNumJobs), nextJob(0), unfinished(inNumJobs) {}
+
+			std::function<void(int)>	job;
+			int							numJobs;
+			int							nextJob;		// next job to hand out
+			int							unfinished;		// jobs handed out or not, that have not returned
+			std::condition_variable		done;
+		};
+
+		// claim the batch's next job and run it unlocked; lock is held on entry and exit
+		void RunJob(const std::shared_ptr<Batch>& batch, std::unique_lock<std::mutex>& lock)
+		{
+			int jobIndex = batch->nextJob++;
+			if (batch->nextJob == batch->numJobs) {
+				mBatches.erase(std::find(mBatches.begin(), mBatches.end(), batch));
+			}
+
+			lock.unlock();
+			batch->job(jobIndex);
+			lock.lock();
+
+			if (--batch->unfinished == 0) {
+				batch->done.notify_all();
+			}
+		}
+
+		void WorkerLoop()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			for (;;) {
+				mWork.wait(lock, [this] { return mStopping || !mBatches.empty(); });
+				if (mStopping) {
+					return;
+				}
+				std::shared_ptr<Batch> batch = mBatches.front();
+				RunJob(batch, lock);
+			}
+		}
+
+		std::vector<std::thread>			mWorkers;
+		std::deque<std::shared_ptr<Batch> >	mBatches;		// batches with jobs left to hand out
+		std::mutex							mMutex;
+		std::condition_variable				mWork;
+		bool								mStopping;
+	};
+
 	THREAD_LOCAL int t_thread = -1;
 
 	std::atomic_int S_cnt;
@@ -64,7 +174,34 @@ namespace {
 	std::recursive_mutex S_mutex;
 
 	AESDK_OpenGL::AESDK_OpenGL_EffectCommonDataPtr S_DepthWaves_EffectCommonData; //global context
-	std::string S_ResourcePath;
+	std::shared_future<AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr> S_DepthWaves_EffectPrograms; //linked in the background, shared by the render contexts
+	std::string S_ShaderPath;
+	std::unique_ptr<WorkerPool> S_WorkerPool;		// for the CPU side of a render
+	std::string S_ProgramCachePath;
+
+	// Link every program on a worker thread, in inWorkerContext, which shares the global context's
+	// objects. The context is made on the calling thread and left current nowhere; it is
+	// released here once the programs are done.
+	AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr LinkEffectPrograms(AESDK_OpenGL::AESDK_OpenGL_EffectCommonDataPtr inWorkerContext,
+																	std::string inShaderPath,
+																	std::string inProgramCachePath)
+	{
+		std::shared_lock<std::shared_timed_mutex> bindingLock(AESDK_OpenGL_GetBindingMutex());
+		inWorkerContext->SetPluginContext();
+
+		AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr programs(new AESDK_OpenGL::AESDK_OpenGL_EffectPrograms());
+		AESDK_OpenGL_InitPrograms(*programs.get(), *inWorkerContext.get(), inShaderPath, inProgramCachePath, DepthWaves_RENDER_GEOMETRY_SHADER != 0);
+
+		inWorkerContext.reset();
+		return programs;
+	}
+
+	// the shared programs, once the worker started at GlobalSetup has linked them; rethrows its error
+	AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr GetEffectPrograms()
+	{
+		DW_PROFILE_STAGE("WaitForPrograms");
+		return S_DepthWaves_EffectPrograms.get();
+	}
 
 	// - OpenGL resources are restricted per thread, mimicking the OGL driver
 	// - The filter will eliminate all TLS (Thread Local Storage) at PF_Cmd_GLOBAL_SETDOWN
@@ -86,198 +223,500 @@ namespace {
 		return result;
 	}
 
-#ifdef AE_OS_WIN
-	std::string get_string_from_wcs(const wchar_t* pcs)
+	// byte offset of one of a block list's indirect draws in drawCommandBuffer
+	void *GetDrawCommandOffset(int list, int command)
 	{
-		int res = WideCharToMultiByte(CP_ACP, 0, pcs, -1, NULL, 0, NULL, NULL);
-
-		std::auto_ptr<char> shared_pbuf(new char[res]);
-
-		char *pbuf = shared_pbuf.get();
-
-		res = WideCharToMultiByte(CP_ACP, 0, pcs, -1, pbuf, res, NULL, NULL);
+		return (void*)((list * AESDK_OpenGL_EffectRenderData::kNumDrawCommands + command) * sizeof(DrawArraysIndirectCommand));
+	}
 
-		return std::string(pbuf);
+	// one point per listed block, expanded into a cube by render-blocks.geom
+	void DrawVisiblePoints(GLuint drawCommandBuffer, int list)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+		glDrawArraysIndirect(GL_POINTS, GetDrawCommandOffset(list, AESDK_OpenGL_EffectRenderData::kPointDrawCommand));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	}
-#endif
 
-	void DrawVertices(GLuint vertBuffer, GLsizei numVerts)
+	// one 14-vertex cube strip per listed block; render-blocks-instanced.vert reads the blocks from the vertex SSBO
+	void DrawInstancedCubes(GLuint drawCommandBuffer, int list)
 	{
-		glEnableVertexAttribArray(PositionSlot);
-		glEnableVertexAttribArray(ColorSlot);
-		glEnableVertexAttribArray(SizeSlot);
-		glBindBuffer(GL_ARRAY_BUFFER, vertBuffer);
-		glVertexAttribPointer(PositionSlot, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-		glVertexAttribPointer(ColorSlot, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(4 * sizeof(gl::GLfloat)));
-		glVertexAttribPointer(SizeSlot, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(8 * sizeof(gl::GLfloat)));
-		glDrawArrays(GL_POINTS, 0, numVerts);
-		glDisableVertexAttribArray(PositionSlot);
-		glDisableVertexAttribArray(ColorSlot);
-		glDisableVertexAttribArray(SizeSlot);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+		glDrawArraysIndirect(GL_TRIANGLE_STRIP, GetDrawCommandOffset(list, AESDK_OpenGL_EffectRenderData::kCubeDrawCommand));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glDisable(GL_CULL_FACE);
 	}
 
-	std::string GetResourcesPath(PF_InData		*in_data)
+	// the vertex shaders read the block list to draw from binding 5
+	void DrawBlockList(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext, int list)
 	{
-		//initialize and compile the shader objects
-		A_UTF16Char pluginFolderPath[AEFX_MAX_PATH];
-		PF_GET_PLATFORM_DATA(PF_PlatData_EXE_FILE_PATH_W, &pluginFolderPath);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, renderContext->blockListBuffers[list]);
 
-#ifdef AE_OS_WIN
-		std::string resourcePath = get_string_from_wcs((wchar_t*)pluginFolderPath);
-		std::string::size_type pos;
-		//delete the plugin name
-		pos = resourcePath.rfind("\\", resourcePath.length());
-		resourcePath = resourcePath.substr(0, pos) + "\\";
-#endif
-#ifdef AE_OS_MAC
-		NSUInteger length = 0;
-		A_UTF16Char* tmp = pluginFolderPath;
-		while (*tmp++ != 0) {
-			++length;
-		}
-		NSString* newStr = [[NSString alloc] initWithCharacters:pluginFolderPath length : length];
-		std::string resourcePath([newStr UTF8String]);
-		resourcePath += "/Contents/Resources/";
+#if DepthWaves_RENDER_GEOMETRY_SHADER
+		DrawVisiblePoints(renderContext->drawCommandBuffer, list);
+#else
+		DrawInstancedCubes(renderContext->drawCommandBuffer, list);
 #endif
-		return resourcePath;
 	}
 
-	struct CopyPixelFloat_t {
-		PF_PixelFloat	*floatBufferP;
-		PF_EffectWorld	*input_worldP;
-	};
-
-	PF_Err
-	CopyPixelFloatIn(
-		void			*refcon,
-		A_long			x,
-		A_long			y,
-		PF_PixelFloat	*inP,
-		PF_PixelFloat	*)
+	// one point sprite per listed block, covering its front face; render-blocks-sprite.vert sizes them
+	void DrawBlockSprites(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext)
 	{
-		CopyPixelFloat_t	*thiS = reinterpret_cast<CopyPixelFloat_t*>(refcon);
-		PF_PixelFloat		*outP = thiS->floatBufferP + y * thiS->input_worldP->width + x;
+		glUseProgram(renderContext->mPrograms->spriteShaderProgram);
 
-		outP->red = inP->red;
-		outP->green = inP->green;
-		outP->blue = inP->blue;
-		outP->alpha = inP->alpha;
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kSpriteList]);
 
-		return PF_Err_NONE;
+		glEnable(GL_PROGRAM_POINT_SIZE);
+		DrawVisiblePoints(renderContext->drawCommandBuffer, AESDK_OpenGL_EffectRenderData::kSpriteList);
+		glDisable(GL_PROGRAM_POINT_SIZE);
 	}
 
-	PF_Err
-	CopyPixelFloatOut(
-		void			*refcon,
-		A_long			x,
-		A_long			y,
-		PF_PixelFloat	*,
-		PF_PixelFloat	*outP)
+	// folder to read the GLSL files from instead of the copies built into the plug-in, for
+	// working on the shaders without rebuilding it. Empty, the default, uses the built-in ones.
+	std::string GetShaderOverridePath()
 	{
-		CopyPixelFloat_t		*thiS = reinterpret_cast<CopyPixelFloat_t*>(refcon);
-		const PF_PixelFloat		*inP = thiS->floatBufferP + y * thiS->input_worldP->width + x;
-
-		outP->red = inP->red;
-		outP->green = inP->green;
-		outP->blue = inP->blue;
-		outP->alpha = inP->alpha;
-
-		return PF_Err_NONE;
+		std::string shaderPath;
+		const char* overrideP = getenv("DEPTHWAVES_SHADER_DIR");
+		if (overrideP) {
+			shaderPath = overrideP;
+			if (!shaderPath.empty() && shaderPath.find_last_of("/\\") != shaderPath.length() - 1) {
+				shaderPath += "/";
+			}
+		}
+		return shaderPath;
 	}
 
-
-	gl::GLuint UploadTexture(GLuint					 unit,				// >>
-							 AEGP_SuiteHandler&		suites,				// >>
-							 PF_PixelFormat			format,				// >>
-							 PF_EffectWorld			*input_worldP,		// >>
-							 PF_EffectWorld			*output_worldP,		// >>
-							 PF_InData				*in_data,			// >>
-							 size_t& pixSizeOut,						// <<
-							 gl::GLenum& glFmtOut,						// <<
-							 float& multiplier16bitOut)					// <<
+	// create every missing directory along inPath, which ends in a separator. Only the last one
+	// has to succeed; the drive or volume roots before it may refuse.
+	bool MakeDirectories(const std::string& inPath)
 	{
-		// - upload to texture memory
-		// - we will convert on-the-fly from ARGB to RGBA, and also to pre-multiplied alpha,
-		// using a fragment shader
-#ifdef _DEBUG
-		GLint nUnpackAlignment;
-		::glGetIntegerv(GL_UNPACK_ALIGNMENT, &nUnpackAlignment);
-		assert(nUnpackAlignment == 4);
+		bool created = false;
+		for (std::string::size_type pos = inPath.find_first_of("/\\", 1); pos != std::string::npos; pos = inPath.find_first_of("/\\", pos + 1)) {
+			std::string dir = inPath.substr(0, pos);
+#ifdef AE_OS_WIN
+			created = CreateDirectoryA(dir.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+			created = mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
 #endif
-		if (input_worldP == NULL) {
-			return 0;
 		}
+		return created;
+	}
 
-		gl::GLuint texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (GLint)GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (GLint)GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (GLint)GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (GLint)GL_CLAMP_TO_EDGE);
+	// per-user directory for linked program binaries, empty when there is none.
+	// DEPTHWAVES_PROGRAM_CACHE overrides it; set it empty to always compile from source.
+	std::string GetProgramCachePath()
+	{
+		std::string cachePath;
+		const char* overrideP = getenv("DEPTHWAVES_PROGRAM_CACHE");
+		if (overrideP) {
+			cachePath = overrideP;
+			if (!cachePath.empty() && cachePath.find_last_of("/\\") != cachePath.length() - 1) {
+				cachePath += "/";
+			}
+		}
+		else {
+#ifdef AE_OS_WIN
+			const char* localAppDataP = getenv("LOCALAPPDATA");
+			if (localAppDataP && *localAppDataP) {
+				cachePath = std::string(localAppDataP) + "\\DepthWaves\\ProgramCache\\";
+			}
+#endif
+#ifdef AE_OS_MAC
+			const char* homeP = getenv("HOME");
+			if (homeP && *homeP) {
+				cachePath = std::string(homeP) + "/Library/Caches/DepthWaves/";
+			}
+#endif
+#ifdef AE_OS_LINUX
+			const char* cacheHomeP = getenv("XDG_CACHE_HOME");
+			const char* homeP = getenv("HOME");
+			if (cacheHomeP && *cacheHomeP) {
+				cachePath = std::string(cacheHomeP) + "/DepthWaves/";
+			}
+			else if (homeP && *homeP) {
+				cachePath = std::string(homeP) + "/.cache/DepthWaves/";
+			}
+#endif
+		}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, (GLint)GL_RGBA32F, input_worldP->width, input_worldP->height, 0, GL_RGBA, GL_FLOAT, nullptr);
+		if (!cachePath.empty() && !MakeDirectories(cachePath)) {
+			cachePath.clear();
+		}
+		return cachePath;
+	}
 
-		multiplier16bitOut = 1.0f;
+	// first pixel of a world, whatever its depth
+	char* GetPixelDataStart(PF_InData			*in_data,
+							PF_PixelFormat		format,
+							PF_EffectWorld		*worldP)
+	{
 		switch (format)
 		{
 		case PF_PixelFormat_ARGB128:
 		{
-			glFmtOut = GL_FLOAT;
-			pixSizeOut = sizeof(PF_PixelFloat);
+			PF_PixelFloat *pixelDataStart = NULL;
+			PF_GET_PIXEL_DATA_FLOAT(worldP, NULL, &pixelDataStart);
+			return reinterpret_cast<char*>(pixelDataStart);
+		}
 
-			std::auto_ptr<PF_PixelFloat> bufferFloat(new PF_PixelFloat[input_worldP->width * input_worldP->height]);
-			CopyPixelFloat_t refcon = { bufferFloat.get(), input_worldP };
+		case PF_PixelFormat_ARGB64:
+		{
+			PF_Pixel16 *pixelDataStart = NULL;
+			PF_GET_PIXEL_DATA16(worldP, NULL, &pixelDataStart);
+			return reinterpret_cast<char*>(pixelDataStart);
+		}
 
-			CHECK(suites.IterateFloatSuite1()->iterate(in_data,
-				0,
-				input_worldP->height,
-				input_worldP,
-				nullptr,
-				reinterpret_cast<void*>(&refcon),
-				CopyPixelFloatIn,
-				output_worldP));
+		case PF_PixelFormat_ARGB32:
+		{
+			PF_Pixel8 *pixelDataStart = NULL;
+			PF_GET_PIXEL_DATA8(worldP, NULL, &pixelDataStart);
+			return reinterpret_cast<char*>(pixelDataStart);
+		}
 
-			glPixelStorei(GL_UNPACK_ROW_LENGTH, input_worldP->width);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, input_worldP->width, input_worldP->height, GL_RGBA, glFmtOut, bufferFloat.get());
+		default:
+			CHECK(PF_Err_BAD_CALLBACK_PARAM);
 			break;
 		}
+		return NULL;
+	}
 
-		case PF_PixelFormat_ARGB64:
+	// input textures keep the layer's own depth, so the upload is a straight copy
+	void GetPixelTransferFormat(PF_PixelFormat	format,				// >>
+								size_t& pixSizeOut,					// <<
+								gl::GLenum& glFmtOut,				// <<
+								gl::GLenum& glInternalFmtOut,		// <<
+								float& multiplier16bitOut)			// <<
+	{
+		multiplier16bitOut = 1.0f;
+		switch (format)
 		{
+		case PF_PixelFormat_ARGB128:
+			glFmtOut = GL_FLOAT;
+			glInternalFmtOut = GL_RGBA32F;
+			pixSizeOut = sizeof(PF_PixelFloat);
+			break;
+
+		case PF_PixelFormat_ARGB64:
 			glFmtOut = GL_UNSIGNED_SHORT;
+			glInternalFmtOut = GL_RGBA16;
 			pixSizeOut = sizeof(PF_Pixel16);
 			multiplier16bitOut = 65535.0f / 32768.0f;
+			break;
 
-			glPixelStorei(GL_UNPACK_ROW_LENGTH, input_worldP->rowbytes / sizeof(PF_Pixel16));
-			PF_Pixel16 *pixelDataStart = NULL;
-			PF_GET_PIXEL_DATA16(input_worldP, NULL, &pixelDataStart);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, input_worldP->width, input_worldP->height, GL_RGBA, glFmtOut, pixelDataStart);
+		case PF_PixelFormat_ARGB32:
+			glFmtOut = GL_UNSIGNED_BYTE;
+			glInternalFmtOut = GL_RGBA8;
+			pixSizeOut = sizeof(PF_Pixel8);
+			break;
+
+		default:
+			CHECK(PF_Err_BAD_CALLBACK_PARAM);
 			break;
 		}
+	}
+
+	// the depth map only uses AE's red channel, so it gets a single-channel texture
+	void GetDepthTransferFormat(PF_PixelFormat	format,				// >>
+								size_t& channelSizeOut,				// <<
+								gl::GLenum& glInternalFmtOut)		// <<
+	{
+		switch (format)
+		{
+		case PF_PixelFormat_ARGB128:
+			channelSizeOut = sizeof(PF_FpShort);
+			glInternalFmtOut = GL_R32F;
+			break;
+
+		case PF_PixelFormat_ARGB64:
+			channelSizeOut = sizeof(A_u_short);
+			glInternalFmtOut = GL_R16;
+			break;
 
 		case PF_PixelFormat_ARGB32:
+			channelSizeOut = sizeof(A_u_char);
+			glInternalFmtOut = GL_R8;
+			break;
+
+		default:
+			CHECK(PF_Err_BAD_CALLBACK_PARAM);
+			break;
+		}
+	}
+
+	// pack the red channel of every pixel tightly; plain strided loads the compiler can vectorise
+	template <typename PixelType, typename ChannelType>
+	void ExtractDepthChannel(const char *srcP, A_long rowbytes, A_long width, A_long height, char *dstP)
+	{
+		ChannelType *outP = reinterpret_cast<ChannelType*>(dstP);
+		for (A_long y = 0; y < height; ++y) {
+			const PixelType *rowP = reinterpret_cast<const PixelType*>(srcP + y * rowbytes);
+			for (A_long x = 0; x < width; ++x) {
+				outP[x] = rowP[x].red;
+			}
+			outP += width;
+		}
+	}
+
+	void ExtractDepth(PF_PixelFormat format, const char *srcP, A_long rowbytes, A_long width, A_long height, char *dstP)
+	{
+		switch (format)
 		{
+		case PF_PixelFormat_ARGB128:
+			ExtractDepthChannel<PF_PixelFloat, PF_FpShort>(srcP, rowbytes, width, height, dstP);
+			break;
 
-			glFmtOut = GL_UNSIGNED_BYTE;
-			pixSizeOut = sizeof(PF_Pixel8);
+		case PF_PixelFormat_ARGB64:
+			ExtractDepthChannel<PF_Pixel16, A_u_short>(srcP, rowbytes, width, height, dstP);
+			break;
 
-			glPixelStorei(GL_UNPACK_ROW_LENGTH, input_worldP->rowbytes / sizeof(PF_Pixel8));
-			PF_Pixel8 *pixelDataStart = NULL;
-			PF_GET_PIXEL_DATA8(input_worldP, NULL, &pixelDataStart);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, input_worldP->width, input_worldP->height, GL_RGBA, glFmtOut, pixelDataStart);
+		case PF_PixelFormat_ARGB32:
+			ExtractDepthChannel<PF_Pixel8, A_u_char>(srcP, rowbytes, width, height, dstP);
+			break;
+
+		default:
 			break;
 		}
+	}
+
+	// bytes spanned by a world's rows, without the padding after the last one
+	size_t GetWorldBytes(const PF_EffectWorld *worldP, size_t pixSize)
+	{
+		if (worldP == NULL || worldP->height <= 0) {
+			return 0;
+		}
+		return (worldP->height - 1) * worldP->rowbytes + worldP->width * pixSize;
+	}
+
+	template <typename ChannelType>
+	ChannelType BlockAverage(double sum, double count)
+	{
+		// integer channels round to nearest, float channels are kept as-is
+		return static_cast<ChannelType>(sum / count + (std::numeric_limits<ChannelType>::is_integer ? 0.5 : 0.0));
+	}
+
+	// area-average block rows [blockRowBegin, blockRowEnd) of a layer, one output pixel per block
+	template <typename PixelType, typename ChannelType>
+	void ReduceColorRows(const char *srcP, A_long rowbytes, A_long width, A_long height,
+						 A_long blocksX, A_long blocksY, A_long blockRowBegin, A_long blockRowEnd, char *dstP)
+	{
+		for (A_long by = blockRowBegin; by < blockRowEnd; ++by) {
+			A_long y0 = by * height / blocksY, y1 = (by + 1) * height / blocksY;
+			PixelType *outP = reinterpret_cast<PixelType*>(dstP) + by * blocksX;
+
+			for (A_long bx = 0; bx < blocksX; ++bx) {
+				A_long x0 = bx * width / blocksX, x1 = (bx + 1) * width / blocksX;
+				double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+				for (A_long y = y0; y < y1; ++y) {
+					const PixelType *rowP = reinterpret_cast<const PixelType*>(srcP + y * rowbytes);
+					for (A_long x = x0; x < x1; ++x) {
+						sum[0] += rowP[x].alpha;
+						sum[1] += rowP[x].red;
+						sum[2] += rowP[x].green;
+						sum[3] += rowP[x].blue;
+					}
+				}
+
+				double count = static_cast<double>((x1 - x0) * (y1 - y0));
+				outP[bx].alpha = BlockAverage<ChannelType>(sum[0], count);
+				outP[bx].red = BlockAverage<ChannelType>(sum[1], count);
+				outP[bx].green = BlockAverage<ChannelType>(sum[2], count);
+				outP[bx].blue = BlockAverage<ChannelType>(sum[3], count);
+			}
+		}
+	}
+
+	// same as ReduceColorRows for the depth map's red channel, packed like ExtractDepthChannel
+	template <typename PixelType, typename ChannelType>
+	void ReduceDepthRows(const char *srcP, A_long rowbytes, A_long width, A_long height,
+						 A_long blocksX, A_long blocksY, A_long blockRowBegin, A_long blockRowEnd, char *dstP)
+	{
+		for (A_long by = blockRowBegin; by < blockRowEnd; ++by) {
+			A_long y0 = by * height / blocksY, y1 = (by + 1) * height / blocksY;
+			ChannelType *outP = reinterpret_cast<ChannelType*>(dstP) + by * blocksX;
+
+			for (A_long bx = 0; bx < blocksX; ++bx) {
+				A_long x0 = bx * width / blocksX, x1 = (bx + 1) * width / blocksX;
+				double sum = 0.0;
+
+				for (A_long y = y0; y < y1; ++y) {
+					const PixelType *rowP = reinterpret_cast<const PixelType*>(srcP + y * rowbytes);
+					for (A_long x = x0; x < x1; ++x) {
+						sum += rowP[x].red;
+					}
+				}
+
+				outP[bx] = BlockAverage<ChannelType>(sum, static_cast<double>((x1 - x0) * (y1 - y0)));
+			}
+		}
+	}
+
+	// a layer on its way into the unpack buffer
+	struct LayerReduction {
+		const char		*srcP;
+		A_long			rowbytes;
+		A_long			width;
+		A_long			height;
+		char			*dstP;
+	};
+
+	void ReduceLayerRows(PF_PixelFormat format, const LayerReduction& color, const LayerReduction& depth,
+						 A_long blocksX, A_long blocksY, A_long blockRowBegin, A_long blockRowEnd)
+	{
+		switch (format)
+		{
+		case PF_PixelFormat_ARGB128:
+			if (color.srcP) {
+				ReduceColorRows<PF_PixelFloat, PF_FpShort>(color.srcP, color.rowbytes, color.width, color.height, blocksX, blocksY, blockRowBegin, blockRowEnd, color.dstP);
+			}
+			if (depth.srcP) {
+				ReduceDepthRows<PF_PixelFloat, PF_FpShort>(depth.srcP, depth.rowbytes, depth.width, depth.height, blocksX, blocksY, blockRowBegin, blockRowEnd, depth.dstP);
+			}
+			break;
+
+		case PF_PixelFormat_ARGB64:
+			if (color.srcP) {
+				ReduceColorRows<PF_Pixel16, A_u_short>(color.srcP, color.rowbytes, color.width, color.height, blocksX, blocksY, blockRowBegin, blockRowEnd, color.dstP);
+			}
+			if (depth.srcP) {
+				ReduceDepthRows<PF_Pixel16, A_u_short>(depth.srcP, depth.rowbytes, depth.width, depth.height, blocksX, blocksY, blockRowBegin, blockRowEnd, depth.dstP);
+			}
+			break;
+
+		case PF_PixelFormat_ARGB32:
+			if (color.srcP) {
+				ReduceColorRows<PF_Pixel8, A_u_char>(color.srcP, color.rowbytes, color.width, color.height, blocksX, blocksY, blockRowBegin, blockRowEnd, color.dstP);
+			}
+			if (depth.srcP) {
+				ReduceDepthRows<PF_Pixel8, A_u_char>(depth.srcP, depth.rowbytes, depth.width, depth.height, blocksX, blocksY, blockRowBegin, blockRowEnd, depth.dstP);
+			}
+			break;
 
 		default:
-			CHECK(PF_Err_BAD_CALLBACK_PARAM);
 			break;
 		}
+	}
+
+	// split the block rows of both layers across the worker pool
+	void ReduceLayers(PF_PixelFormat format, const LayerReduction& color, const LayerReduction& depth, A_long blocksX, A_long blocksY)
+	{
+		if (!S_WorkerPool) {
+			ReduceLayerRows(format, color, depth, blocksX, blocksY, 0, blocksY);
+			return;
+		}
+
+		A_long numJobs = (std::max)((A_long)1, (std::min)((A_long)S_WorkerPool->GetNumThreads(), blocksY));
+		S_WorkerPool->Run(numJobs, [&](int job) {
+			ReduceLayerRows(format, color, depth, blocksX, blocksY, job * blocksY / numJobs, (job + 1) * blocksY / numJobs);
+		});
+	}
+
+	// where StageLayers left a layer in the unpack buffer
+	struct StagedLayer {
+		A_long			width;
+		A_long			height;
+		GLint			rowLength;
+		gl::GLintptr	offset;
+	};
+
+	// The compute shader takes one sample per block, so when the block grid is coarser than the
+	// layers both are area-averaged down to it and only that is uploaded. Otherwise colour rows
+	// are copied as-is (GL_UNPACK_ROW_LENGTH skips the padding) and the depth map is reduced to
+	// its one used channel on the way in.
+	void StageLayers(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+					 PF_InData				*in_data,			// >>
+					 PF_PixelFormat			format,				// >>
+					 PF_EffectWorld			*color_worldP,		// >>
+					 PF_EffectWorld			*depth_worldP,		// >>
+					 A_long					numBlocksX,			// >>
+					 A_long					numBlocksY,			// >>
+					 size_t					pixSize,			// >>
+					 size_t					depthChannelSize,	// >>
+					 StagedLayer&			colorOut,			// <<
+					 StagedLayer&			depthOut)			// <<
+	{
+		DW_PROFILE_STAGE("StageLayers");
 
+		bool reduceColor = color_worldP && numBlocksX <= color_worldP->width && numBlocksY <= color_worldP->height;
+		bool reduceDepth = depth_worldP && numBlocksX <= depth_worldP->width && numBlocksY <= depth_worldP->height;
+
+		colorOut.width = reduceColor ? numBlocksX : color_worldP ? color_worldP->width : 0;
+		colorOut.height = reduceColor ? numBlocksY : color_worldP ? color_worldP->height : 0;
+		colorOut.rowLength = reduceColor ? numBlocksX : color_worldP ? (GLint)(color_worldP->rowbytes / pixSize) : 0;
+		colorOut.offset = 0;
+
+		depthOut.width = reduceDepth ? numBlocksX : depth_worldP ? depth_worldP->width : 0;
+		depthOut.height = reduceDepth ? numBlocksY : depth_worldP ? depth_worldP->height : 0;
+		depthOut.rowLength = depthOut.width;
+
+		size_t colorBytes = reduceColor ? numBlocksX * numBlocksY * pixSize : GetWorldBytes(color_worldP, pixSize);
+		size_t depthBytes = depthOut.width * depthOut.height * depthChannelSize;
+		depthOut.offset = (colorBytes + 15) & ~(size_t)15;
+
+		AESDK_OpenGL_InitUploadBuffer(*renderContext.get(), (std::max)((size_t)depthOut.offset + depthBytes, (size_t)16));
+
+		// last frame's texture uploads may still be sourcing the buffer
+		AESDK_OpenGL_WaitFence(renderContext->mUploadFence);
+
+		char *stagingP = reinterpret_cast<char*>(renderContext->mUploadBufferP);
+		const char *colorP = colorBytes ? GetPixelDataStart(in_data, format, color_worldP) : NULL;
+		const char *depthP = depthBytes ? GetPixelDataStart(in_data, format, depth_worldP) : NULL;
+
+		LayerReduction colorReduction = { NULL, 0, 0, 0, NULL };
+		LayerReduction depthReduction = { NULL, 0, 0, 0, NULL };
+		if (reduceColor && colorP) {
+			LayerReduction reduction = { colorP, color_worldP->rowbytes, color_worldP->width, color_worldP->height, stagingP };
+			colorReduction = reduction;
+		}
+		if (reduceDepth && depthP) {
+			LayerReduction reduction = { depthP, depth_worldP->rowbytes, depth_worldP->width, depth_worldP->height, stagingP + depthOut.offset };
+			depthReduction = reduction;
+		}
+		if (colorReduction.srcP || depthReduction.srcP) {
+			ReduceLayers(format, colorReduction, depthReduction, numBlocksX, numBlocksY);
+		}
+
+		// full-resolution layers are single linear passes, cheaper done here than handed to a thread
+		if (colorP && !reduceColor) {
+			::memcpy(stagingP, colorP, colorBytes);
+		}
+		if (depthP && !reduceDepth) {
+			ExtractDepth(format, depthP, depth_worldP->rowbytes, depth_worldP->width, depth_worldP->height, stagingP + depthOut.offset);
+		}
+	}
+
+	gl::GLuint UploadTexture(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+							 const StagedLayer&		layer,				// >>
+							 gl::GLenum				glPixelFmt,			// >> GL_RGBA or GL_RED
+							 gl::GLenum				glFmt,				// >>
+							 gl::GLenum				glInternalFmt)		// >>
+	{
+		DW_PROFILE_STAGE("UploadTexture");
+
+		// - upload to texture memory
+		// - AE's ARGB is stored as-is; the pooled texture's swizzle presents it to the shaders as RGBA
+		// - single-channel depth is read as .r and needs no swizzle
+#ifdef _DEBUG
+		GLint nUnpackAlignment;
+		::glGetIntegerv(GL_UNPACK_ALIGNMENT, &nUnpackAlignment);
+		assert(nUnpackAlignment == 4);
+#endif
+		if (layer.width <= 0 || layer.height <= 0) {
+			return 0;
+		}
+
+		gl::GLuint texture = AESDK_OpenGL_AcquireTexture(*renderContext.get(), glInternalFmt, layer.width, layer.height);
+
+		// source the texels from the staged rows; packed single-channel rows need not be 4-byte aligned
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderContext->mUploadBuffer);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, layer.rowLength);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTextureSubImage2D(texture, 0, 0, 0, layer.width, layer.height, glPixelFmt, glFmt, reinterpret_cast<const void*>(layer.offset));
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
 		return texture;
 	}
@@ -688,45 +1127,325 @@ namespace {
 		return err;
 	}
 
+	// The HSL of an RGB colour; only its saturation and lightness are used by compute-particles.glsl.
+	void RGBToHSL(const gl::GLfloat rgb[3], gl::GLfloat hsl[3])
+	{
+		gl::GLfloat fmin = std::min(std::min(rgb[0], rgb[1]), rgb[2]);
+		gl::GLfloat fmax = std::max(std::max(rgb[0], rgb[1]), rgb[2]);
+		gl::GLfloat delta = fmax - fmin;
+
+		hsl[2] = (fmax + fmin) / 2.f;
+
+		if (delta == 0.f) {
+			// a gray, no chroma
+			hsl[0] = 0.f;
+			hsl[1] = 0.f;
+			return;
+		}
+
+		hsl[1] = hsl[2] < 0.5f ? delta / (fmax + fmin) : delta / (2.f - fmax - fmin);
+
+		gl::GLfloat deltaR = (((fmax - rgb[0]) / 6.f) + (delta / 2.f)) / delta;
+		gl::GLfloat deltaG = (((fmax - rgb[1]) / 6.f) + (delta / 2.f)) / delta;
+		gl::GLfloat deltaB = (((fmax - rgb[2]) / 6.f) + (delta / 2.f)) / delta;
+
+		if (rgb[0] == fmax) {
+			hsl[0] = deltaB - deltaG;
+		} else if (rgb[1] == fmax) {
+			hsl[0] = (1.f / 3.f) + deltaR - deltaB;
+		} else {
+			hsl[0] = (2.f / 3.f) + deltaG - deltaR;
+		}
+
+		if (hsl[0] < 0.f) {
+			hsl[0] += 1.f;
+		} else if (hsl[0] > 1.f) {
+			hsl[0] -= 1.f;
+		}
+	}
+
+	// Work out the per-wave terms of the displacement once here rather than per block in
+	// compute-particles.glsl; see packed-wave.h for the layout.
+	void PackWaves(
+		const std::vector<Wave> &waves,
+		bool colorizeWaves,
+		std::vector<PackedWave> &packedWaves
+	) {
+		packedWaves.resize(waves.size());
+
+		for (size_t i = 0; i < waves.size(); ++i) {
+			const Wave &wave = waves[i];
+			PackedWave &packed = packedWaves[i];
+
+			memcpy(packed.position, wave.position, 3 * sizeof(gl::GLfloat));
+			packed.position[3] = wave.outerRadius;
+
+			// a direction too short to mean anything pushes blocks away from the wave's centre instead
+			const gl::GLfloat *d = wave.displacement;
+			gl::GLfloat length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			for (int c = 0; c < 3; ++c) {
+				packed.displacement[c] = length < 0.01f ? 0.f : d[c] / length;
+			}
+			packed.displacement[3] = d[3];
+
+			if (colorizeWaves) {
+				RGBToHSL(wave.color, packed.color);
+				packed.color[3] = wave.color[3];
+			} else {
+				memcpy(packed.color, wave.color, 4 * sizeof(gl::GLfloat));
+			}
+
+			// a shell with no width has nothing to displace
+			gl::GLfloat width = wave.outerRadius - wave.innerRadius;
+			packed.shell[0] = wave.innerRadius;
+			packed.shell[1] = width > 0.f ? 1.f / width : 0.f;
+			packed.shell[2] = wave.blockSizeMultiplier;
+			packed.shell[3] = wave.colorMix;
+		}
+	}
+
+	// Fill the EffectParams block (effect-params.h) from the info and bind it for every pass
+	// of the frame: one write into the dynamic ring and one bind, instead of glUniform calls
+	// per program.
+	void SetEffectParams(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+						 A_long widthL,
+						 A_long heightL,
+						 DepthWavesInfo *info,
+						 float multiplier16bit)
+	{
+		EffectParams params;
+		memset(&params, 0, sizeof(params));
+
+		memcpy(params.modelViewProjectionMatrix, &info->cameraTransform.projectionMatrix, sizeof(params.modelViewProjectionMatrix));
+		params.cameraFov[0] = (gl::GLfloat)info->cameraTransform.fov.getX();
+		params.cameraFov[1] = (gl::GLfloat)info->cameraTransform.fov.getY();
+		params.blockCount[0] = (gl::GLuint)info->numBlocksX;
+		params.blockCount[1] = (gl::GLuint)info->numBlocksY;
+		params.viewportSize[0] = (gl::GLfloat)widthL;
+		params.viewportSize[1] = (gl::GLfloat)heightL;
+		params.minDepth = (gl::GLfloat)info->minDepth;
+		params.maxDepth = (gl::GLfloat)info->maxDepth;
+		params.nearBlockSize = (gl::GLfloat)info->nearBlockSize;
+		params.farBlockSize = (gl::GLfloat)info->farBlockSize;
+		params.colorCycleRadius = (gl::GLfloat)info->colorCycleRadius;
+
+		// with occlusion culling, only the near blocks are drawn before the Hi-Z pyramid is built
+		params.occluderDepth = info->occlusionCulling ?
+			(gl::GLfloat)(info->minDepth + DepthWaves_OCCLUDER_DEPTH_FRACTION * (info->maxDepth - info->minDepth)) :
+			std::numeric_limits<gl::GLfloat>::infinity();
+
+		// with the compute rasterizer, the tiny blocks are left out of the hardware draws
+		params.microBlockPixels = info->computeRasterizer ? (gl::GLfloat)DepthWaves_MICRO_BLOCK_PIXELS : 0.f;
+		params.lodSpritePixels = (gl::GLfloat)info->lodSpritePixels;
+		params.multiplier16bit = multiplier16bit;
+		params.waveCount = (gl::GLint)info->numWaves;
+
+		memcpy(AESDK_OpenGL_AllocDynamic(*renderContext, sizeof(params), renderContext->mEffectParamsOffset), &params, sizeof(params));
+		glBindBufferRange(GL_UNIFORM_BUFFER, AESDK_OpenGL_EffectPrograms::kEffectParamsBinding,
+			renderContext->mDynamicBuffer, renderContext->mEffectParamsOffset, sizeof(params));
+	}
+
+	// Bind the DispatchParams block for the next dispatch, from a fresh range of the dynamic ring
+	void SetDispatchParams(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+						   const DispatchParams& params)
+	{
+		gl::GLintptr offset;
+		memcpy(AESDK_OpenGL_AllocDynamic(*renderContext, sizeof(params), offset), &params, sizeof(params));
+		glBindBufferRange(GL_UNIFORM_BUFFER, AESDK_OpenGL_EffectPrograms::kDispatchParamsBinding,
+			renderContext->mDynamicBuffer, offset, sizeof(params));
+	}
+
+	// the compute-particles.glsl variant for the frame, so it only runs the wave code it needs
+	int GetComputeVariant(const DepthWavesInfo *info)
+	{
+		if (info->numWaves == 0) {
+			return AESDK_OpenGL_EffectPrograms::kComputeNoWaves;
+		}
+		return info->colorizeWaves ? AESDK_OpenGL_EffectPrograms::kComputeColorizedWaves : AESDK_OpenGL_EffectPrograms::kComputeWaves;
+	}
+
 	void ComputeParticles(
 		const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
 		gl::GLuint colorLayerTexture,
 		gl::GLuint depthLayerTexture,
 		DepthWavesInfo *info
 	) {
-		GLuint program = renderContext->computeShaderProgram;
+		DW_PROFILE_STAGE("ComputeParticles");
+
+		GLuint program = renderContext->mPrograms->computeShaderPrograms[GetComputeVariant(info)];
 		glUseProgram(program);
 
-		glBindImageTexture(0, colorLayerTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-		glBindImageTexture(1, depthLayerTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+		// sampled rather than bound as images, so the ARGB swizzle applies
+		glBindTextureUnit(0, colorLayerTexture);
+		glBindTextureUnit(1, depthLayerTexture);
+
+		// the culling passes count the blocks of each list into these
+		DrawArraysIndirectCommand emptyDraws[AESDK_OpenGL_EffectRenderData::kNumBlockLists][AESDK_OpenGL_EffectRenderData::kNumDrawCommands];
+		for (int list = 0; list < AESDK_OpenGL_EffectRenderData::kNumBlockLists; ++list) {
+			DrawArraysIndirectCommand cubes = { 14, 0, 0, 0 };	// instances
+			DrawArraysIndirectCommand points = { 0, 1, 0, 0 };	// vertices
+			emptyDraws[list][AESDK_OpenGL_EffectRenderData::kCubeDrawCommand] = cubes;
+			emptyDraws[list][AESDK_OpenGL_EffectRenderData::kPointDrawCommand] = points;
+		}
+		glNamedBufferSubData(renderContext->drawCommandBuffer, 0, sizeof(emptyDraws), emptyDraws);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, renderContext->drawCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kDrawList]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kOcclusionCandidateList]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kMicroBlockList]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kSpriteList]);
 
-		GLuint u;
-		u = glGetUniformLocation(program, "minDepth");
-		glUniform1f(u, (gl::GLfloat)info->minDepth);
+		// one invocation per block, in whole tiles
+		glDispatchCompute(
+			(info->numBlocksX + DepthWaves_COMPUTE_TILE_SIZE - 1) / DepthWaves_COMPUTE_TILE_SIZE,
+			(info->numBlocksY + DepthWaves_COMPUTE_TILE_SIZE - 1) / DepthWaves_COMPUTE_TILE_SIZE,
+			1);
 
-		u = glGetUniformLocation(program, "maxDepth");
-		glUniform1f(u, (gl::GLfloat)info->maxDepth);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+		
+		glUseProgram(0);
+	}
 
-		u = glGetUniformLocation(program, "nearBlockSize");
-		glUniform1f(u, (gl::GLfloat)info->nearBlockSize);
+	// reduce the depth of what has been drawn so far into the Hi-Z pyramid, one level per dispatch
+	void BuildHiZ(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext)
+	{
+		glUseProgram(renderContext->mPrograms->hiZShaderProgram);
 
-		u = glGetUniformLocation(program, "farBlockSize");
-		glUniform1f(u, (gl::GLfloat)info->farBlockSize);
+		DispatchParams params;
+		memset(&params, 0, sizeof(params));
 
-		u = glGetUniformLocation(program, "cameraFov");
-		glUniform2fv(u, 1, (gl::GLfloat*)&info->cameraTransform.fov);
+		// the depth writes have to land before they are sampled
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
 
-		u = glGetUniformLocation(program, "waveCount");
-		glUniform1i(u, info->numWaves);
+		for (gl::GLint level = 0; level < renderContext->mHiZLevels; ++level) {
+			gl::GLint width, height;
+			glGetTextureLevelParameteriv(renderContext->mHiZTexture, level, GL_TEXTURE_WIDTH, &width);
+			glGetTextureLevelParameteriv(renderContext->mHiZTexture, level, GL_TEXTURE_HEIGHT, &height);
 
-		u = glGetUniformLocation(program, "colorizeWaves");
-		glUniform1i(u, (gl::GLint)info->colorizeWaves);
+			if (level == 0) {
+				glBindTextureUnit(0, renderContext->mDepthTextureSu);
+				params.srcLod = 0;
+			} else {
+				glBindTextureUnit(0, renderContext->mHiZTexture);
+				params.srcLod = level - 1;
+			}
+			SetDispatchParams(renderContext, params);
+			glBindImageTexture(0, renderContext->mHiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
 
-		u = glGetUniformLocation(program, "colorCycleRadius");
-		glUniform1f(u, (gl::GLfloat)info->colorCycleRadius);
+			glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		}
+
+		glBindTextureUnit(0, 0);
+		glUseProgram(0);
+	}
+
+	// test the far blocks against the Hi-Z pyramid, keeping the ones that may show in the survivor list
+	void CullOccludedBlocks(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+							DepthWavesInfo *info)
+	{
+		DW_PROFILE_STAGE("CullOccludedBlocks");
+
+		BuildHiZ(renderContext);
+
+		glUseProgram(renderContext->mPrograms->occlusionShaderProgram);
+
+		glBindTextureUnit(0, renderContext->mHiZTexture);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, renderContext->drawCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kOcclusionCandidateList]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kOcclusionSurvivorList]);
+
+		// sized for every block; invocations past the candidate count return straight away
+		gl::GLuint numBlocks = (gl::GLuint)(info->numBlocksX * info->numBlocksY);
+		glDispatchCompute((numBlocks + 63) / 64, 1, 1);
+
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		glBindTextureUnit(0, 0);
+		glUseProgram(0);
+	}
+
+	// order a block list by distance from the camera so near blocks fill the depth buffer first
+	void SortBlockList(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+					   int list,
+					   DepthWavesInfo *info)
+	{
+		DW_PROFILE_STAGE("SortBlocks");
+
+		glUseProgram(renderContext->mPrograms->sortShaderProgram);
+
+		DispatchParams params;
+		memset(&params, 0, sizeof(params));
+		params.sortList = list;
+
+		glClearNamedBufferData(renderContext->mSortBucketBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, renderContext->drawCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, renderContext->blockListBuffers[list]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, renderContext->mSortedBlockBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, renderContext->mSortBucketBuffer);
+
+		// sized for every block, like the occlusion pass
+		gl::GLuint numBlocks = (gl::GLuint)(info->numBlocksX * info->numBlocksY);
+		gl::GLuint numGroups = (numBlocks + AESDK_OpenGL_EffectRenderData::kSortBuckets - 1) / AESDK_OpenGL_EffectRenderData::kSortBuckets;
+
+		// count, scan, scatter (PASS_* in sort-blocks.glsl)
+		params.sortPass = 0;
+		SetDispatchParams(renderContext, params);
+		glDispatchCompute(numGroups, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		params.sortPass = 1;
+		SetDispatchParams(renderContext, params);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		params.sortPass = 2;
+		SetDispatchParams(renderContext, params);
+		glDispatchCompute(numGroups, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		// the sorted copy becomes the list; the old one is scratch for the next sort
+		std::swap(renderContext->blockListBuffers[list], renderContext->mSortedBlockBuffer);
+
+		glUseProgram(0);
+	}
+
+	// splat the tiny blocks into the visibility buffer, then shade it over what the hardware drew
+	void RasterizeMicroBlocks(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+							  DepthWavesInfo *info)
+	{
+		DW_PROFILE_STAGE("RasterizeMicroBlocks");
+
+		glUseProgram(renderContext->mPrograms->microRasterShaderProgram);
+
+		gl::GLuint empty = 0xFFFFFFFF;
+		glClearNamedBufferData(renderContext->mVisibilityBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &empty);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, renderContext->drawCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, renderContext->blockListBuffers[AESDK_OpenGL_EffectRenderData::kMicroBlockList]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, renderContext->mVisibilityBuffer);
+
+		// sized for every block; invocations past the micro block count return straight away
+		gl::GLuint numBlocks = (gl::GLuint)(info->numBlocksX * info->numBlocksY);
+		if (renderContext->mPrograms->mPackedVisibility) {
+			glDispatchCompute((numBlocks + 63) / 64, 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		} else {
+			// nearest depth first, then the block at it
+			DispatchParams params;
+			memset(&params, 0, sizeof(params));
+			for (gl::GLint pass = 0; pass < 2; ++pass) {
+				params.splatPass = pass;
+				SetDispatchParams(renderContext, params);
+				glDispatchCompute((numBlocks + 63) / 64, 1, 1);
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			}
+		}
+
+		glUseProgram(renderContext->mPrograms->microResolveShaderProgram);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
 
-		glDispatchCompute(info->numBlocksX, info->numBlocksY, 1);
-		
 		glUseProgram(0);
 	}
 
@@ -737,31 +1456,44 @@ namespace {
 				  DepthWavesInfo *info,
 				  float multiplier16bit)
 	{
+		DW_PROFILE_STAGE("RenderGL");
 
-		gl::GLuint program = renderContext->visualShaderProgram;
-		GLuint u;
+		gl::GLuint program = renderContext->mPrograms->visualShaderProgram;
 
 		glEnable(GL_DEPTH_TEST);
 
-		// send uniforms to shader
+		// the uniforms are all in the EffectParams block SetEffectParams bound
 		glUseProgram(program);
 
-		u = glGetUniformLocation(program, "modelViewProjectionMatrix");
-		glUniformMatrix4fv(u, 1, GL_TRUE, (gl::GLfloat*)&info->cameraTransform.projectionMatrix);
+		// render
+		if (info->sortFrontToBack) {
+			SortBlockList(renderContext, AESDK_OpenGL_EffectRenderData::kDrawList, info);
+			glUseProgram(program);
+		}
 
-		u = glGetUniformLocation(program, "nearBlockSize");
-		glUniform1f(u, (gl::GLfloat)info->nearBlockSize);
+		glBindVertexArray(renderContext->vao);
+		{
+			DW_PROFILE_SAMPLES_PASSED("SamplesPassed");
+			DrawBlockList(renderContext, AESDK_OpenGL_EffectRenderData::kDrawList);
 
-		u = glGetUniformLocation(program, "farBlockSize");
-		glUniform1f(u, (gl::GLfloat)info->farBlockSize);
+			DrawBlockSprites(renderContext);
 
-		u = glGetUniformLocation(program, "multiplier16bit");
-		glUniform1f(u, multiplier16bit);
+			// then whatever the near blocks just drawn do not hide
+			if (info->occlusionCulling) {
+				CullOccludedBlocks(renderContext, info);
 
-		// render
-		glBindVertexArray(renderContext->vao);
+				if (info->sortFrontToBack) {
+					SortBlockList(renderContext, AESDK_OpenGL_EffectRenderData::kOcclusionSurvivorList, info);
+				}
 
-		DrawVertices(renderContext->vertBuffer, widthL * heightL);
+				glUseProgram(program);
+				DrawBlockList(renderContext, AESDK_OpenGL_EffectRenderData::kOcclusionSurvivorList);
+			}
+
+			if (info->computeRasterizer) {
+				RasterizeMicroBlocks(renderContext, info);
+			}
+		}
 		glBindVertexArray(0);
 
 		glUseProgram(0);
@@ -769,9 +1501,23 @@ namespace {
 		glDisable(GL_BLEND);
 	}
 
+	// queue an async read of one horizontal strip of the FBO into the ring slot it maps to
+	void ReadbackStrip(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
+					   A_long strip,
+					   A_long stripRows,
+					   A_long widthL,
+					   A_long heightL,
+					   gl::GLenum glFmt)
+	{
+		int slot = strip % AESDK_OpenGL_EffectRenderData::kReadbackRingSize;
+		A_long y = strip * stripRows;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, renderContext->mReadbackBuffers[slot]);
+		glReadPixels(0, y, widthL, (std::min)(stripRows, heightL - y), GL_RGBA, glFmt, nullptr);
+		renderContext->mReadbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
+	}
+
 	void DownloadTexture(const AESDK_OpenGL::AESDK_OpenGL_EffectRenderDataPtr& renderContext,
-						 AEGP_SuiteHandler&		suites,				// >>
-						 PF_EffectWorld			*input_worldP,		// >>
 						 PF_EffectWorld			*output_worldP,		// >>
 						 PF_InData				*in_data,			// >>
 						 PF_PixelFormat			format,				// >>
@@ -779,75 +1525,57 @@ namespace {
 						 gl::GLenum				glFmt				// >>
 						 )
 	{
-		//download from texture memory onto the same surface
-		PF_Handle bufferH = NULL;
-		bufferH = suites.HandleSuite1()->host_new_handle(((renderContext->mRenderBufferWidthSu * renderContext->mRenderBufferHeightSu)* pixSize));
-		if (!bufferH) {
-			CHECK(PF_Err_OUT_OF_MEMORY);
-		}
-		void *bufferP = suites.HandleSuite1()->host_lock_handle(bufferH);
+		DW_PROFILE_STAGE("DownloadTexture");
 
-		glReadBuffer(GL_COLOR_ATTACHMENT0);
-		glReadPixels(0, 0, renderContext->mRenderBufferWidthSu, renderContext->mRenderBufferHeightSu, GL_RGBA, glFmt, bufferP);
+		char *dstP = GetPixelDataStart(in_data, format, output_worldP);
 
-		switch (format)
-		{
-		case PF_PixelFormat_ARGB128:
-		{
-			PF_PixelFloat* bufferFloatP = reinterpret_cast<PF_PixelFloat*>(bufferP);
-			CopyPixelFloat_t refcon = { bufferFloatP, input_worldP };
-
-			CHECK(suites.IterateFloatSuite1()->iterate(in_data,
-				0,
-				input_worldP->height,
-				input_worldP,
-				nullptr,
-				reinterpret_cast<void*>(&refcon),
-				CopyPixelFloatOut,
-				output_worldP));
-			break;
+		A_long widthL = (std::min)((A_long)renderContext->mRenderBufferWidthSu, output_worldP->width);
+		A_long heightL = (std::min)((A_long)renderContext->mRenderBufferHeightSu, output_worldP->height);
+		size_t rowBytes = output_worldP->rowbytes;
+		if (widthL <= 0 || heightL <= 0) {
+			return;
 		}
 
-		case PF_PixelFormat_ARGB64:
-		{
-			PF_Pixel16* buffer16P = reinterpret_cast<PF_Pixel16*>(bufferP);
+		// pack straight into the output world's row layout, so each strip is one contiguous copy
+		// and the CPU copies strip n while the GPU is still packing strip n+1
+		const int ringSize = AESDK_OpenGL_EffectRenderData::kReadbackRingSize;
+		A_long stripRows = (std::max)((A_long)1, (std::min)(heightL, (A_long)(DepthWaves_READBACK_STRIP_BYTES / rowBytes)));
+		A_long numStrips = (heightL + stripRows - 1) / stripRows;
+		size_t stripBytes = (stripRows - 1) * rowBytes + widthL * pixSize;
 
-			//copy to output_worldP
-			for (int y = 0; y < output_worldP->height; ++y)
-			{
-				PF_Pixel16 *pixelDataStart = NULL;
-				PF_GET_PIXEL_DATA16(output_worldP, NULL, &pixelDataStart);
-				::memcpy(pixelDataStart + (y * output_worldP->rowbytes / sizeof(PF_Pixel16)),
-					buffer16P + (y * renderContext->mRenderBufferWidthSu),
-					output_worldP->width * sizeof(PF_Pixel16));
-			}
-			break;
+		AESDK_OpenGL_InitReadbackRing(*renderContext.get(), stripBytes);
+
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)(rowBytes / pixSize));
+
+		for (A_long strip = 0; strip < (std::min)((A_long)ringSize, numStrips); ++strip) {
+			ReadbackStrip(renderContext, strip, stripRows, widthL, heightL, glFmt);
 		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-		case PF_PixelFormat_ARGB32:
-		{
-			PF_Pixel8 *buffer8P = reinterpret_cast<PF_Pixel8*>(bufferP);
+		for (A_long strip = 0; strip < numStrips; ++strip) {
+			int slot = strip % ringSize;
+			A_long y = strip * stripRows;
+			A_long rows = (std::min)(stripRows, heightL - y);
+			size_t bytes = (rows - 1) * rowBytes + widthL * pixSize;
 
-			//copy to output_worldP
-			for (int y = 0; y < output_worldP->height; ++y)
-			{
-				PF_Pixel8 *pixelDataStart = NULL;
-				PF_GET_PIXEL_DATA8(output_worldP, NULL, &pixelDataStart);
-				::memcpy(pixelDataStart + (y * output_worldP->rowbytes / sizeof(PF_Pixel8)),
-					buffer8P + (y * renderContext->mRenderBufferWidthSu),
-					output_worldP->width * sizeof(PF_Pixel8));
+			AESDK_OpenGL_WaitFence(renderContext->mReadbackFences[slot]);
+
+			void *srcP = glMapNamedBufferRange(renderContext->mReadbackBuffers[slot], 0, bytes, GL_MAP_READ_BIT);
+			if (!srcP) {
+				CHECK(PF_Err_OUT_OF_MEMORY);
 			}
-			break;
-		}
+			::memcpy(dstP + y * rowBytes, srcP, bytes);
+			glUnmapNamedBuffer(renderContext->mReadbackBuffers[slot]);
 
-		default:
-			CHECK(PF_Err_BAD_CALLBACK_PARAM);
-			break;
+			// refill the slot we just drained
+			if (strip + ringSize < numStrips) {
+				ReadbackStrip(renderContext, strip + ringSize, stripRows, widthL, heightL, glFmt);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			}
 		}
 
-		//clean the data after being copied
-		suites.HandleSuite1()->host_unlock_handle(bufferH);
-		suites.HandleSuite1()->host_dispose_handle(bufferH);
+		glPixelStorei(GL_PACK_ROW_LENGTH, 0);
 	}
 } // anonymous namespace
 
@@ -905,7 +1633,22 @@ GlobalSetup (
 		S_DepthWaves_EffectCommonData.reset(new AESDK_OpenGL::AESDK_OpenGL_EffectCommonData());
 		AESDK_OpenGL_Startup(*S_DepthWaves_EffectCommonData.get());
 		
-		S_ResourcePath = GetResourcesPath(in_data);
+		S_ShaderPath = GetShaderOverridePath();
+		S_ProgramCachePath = GetProgramCachePath();
+
+		// the render thread calling into the pool makes up the last core
+		S_WorkerPool.reset(new WorkerPool((std::max)(std::thread::hardware_concurrency(), 1u) - 1));
+
+		// link every program once, in the background, rather than in each render thread's context;
+		// a render that arrives first waits for it in GetEffectPrograms
+		AESDK_OpenGL::AESDK_OpenGL_EffectCommonDataPtr workerContext(new AESDK_OpenGL::AESDK_OpenGL_EffectCommonData());
+		AESDK_OpenGL_Startup(*workerContext.get(), S_DepthWaves_EffectCommonData.get());
+		// the worker thread cannot make its context current while this one has it
+		{
+			std::shared_lock<std::shared_timed_mutex> bindingLock(AESDK_OpenGL_GetBindingMutex());
+			S_DepthWaves_EffectCommonData->SetPluginContext();
+		}
+		S_DepthWaves_EffectPrograms = std::async(std::launch::async, LinkEffectPrograms, workerContext, S_ShaderPath, S_ProgramCachePath).share();
 	}
 	catch(PF_Err& thrown_err)
 	{
@@ -1182,6 +1925,36 @@ ParamsSetup (
 
 	AEFX_CLR_STRUCT(def);
 
+	// Occlusion Culling Checkbox
+	PF_ADD_CHECKBOXX(
+		STR(StrID_Occlusion_Culling_Checkbox_Name),
+		DepthWaves_OCCLUSION_CULLING_CHECKBOX_DEFAULT,
+		PF_ParamFlag_RESERVED1,
+		OCCLUSION_CULLING_DISK_ID
+	);
+
+	AEFX_CLR_STRUCT(def);
+
+	// Sort Front To Back Checkbox
+	PF_ADD_CHECKBOXX(
+		STR(StrID_Sort_Front_To_Back_Checkbox_Name),
+		DepthWaves_SORT_FRONT_TO_BACK_CHECKBOX_DEFAULT,
+		PF_ParamFlag_RESERVED1,
+		SORT_FRONT_TO_BACK_DISK_ID
+	);
+
+	AEFX_CLR_STRUCT(def);
+
+	// Compute Rasterizer Checkbox
+	PF_ADD_CHECKBOXX(
+		STR(StrID_Compute_Rasterizer_Checkbox_Name),
+		DepthWaves_COMPUTE_RASTERIZER_CHECKBOX_DEFAULT,
+		PF_ParamFlag_RESERVED1,
+		COMPUTE_RASTERIZER_DISK_ID
+	);
+
+	AEFX_CLR_STRUCT(def);
+
 	out_data->num_params = DepthWaves_NUM_PARAMS;
 
 	return err;
@@ -1201,15 +1974,32 @@ GlobalSetdown (
 	{
 		// always restore back AE's own OGL context
 		SaveRestoreOGLContext oSavedContext;
+		std::shared_lock<std::shared_timed_mutex> bindingLock(AESDK_OpenGL_GetBindingMutex());
 
 		S_mutex.lock();
 		S_render_contexts.clear();
 		S_mutex.unlock();
 
+		// the render contexts are gone; the programs go with the global context they were shared with
+		if (S_DepthWaves_EffectPrograms.valid()) {
+			S_DepthWaves_EffectPrograms.wait();
+			try {
+				AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr programs = S_DepthWaves_EffectPrograms.get();
+				S_DepthWaves_EffectCommonData->SetPluginContext();
+				AESDK_OpenGL_ReleasePrograms(*programs.get());
+			}
+			catch (...) {
+				// linking failed; the renders have reported it already
+			}
+			S_DepthWaves_EffectPrograms = std::shared_future<AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr>();
+		}
+
 		//OS specific unloading
 		AESDK_OpenGL_Shutdown(*S_DepthWaves_EffectCommonData.get());
 		S_DepthWaves_EffectCommonData.reset();
-		S_ResourcePath.clear();
+		S_WorkerPool.reset();
+		S_ShaderPath.clear();
+		S_ProgramCachePath.clear();
 
 		if (in_data->sequence_data) {
 			PF_DISPOSE_HANDLE(in_data->sequence_data);
@@ -1262,13 +2052,16 @@ PreRender(
 		numBlocksX_param,
 		numBlocksY_param,
 		colorizeWaves_param,
-		colorizeWavesCycleRadius_param;
+		colorizeWavesCycleRadius_param,
+		occlusionCulling_param,
+		sortFrontToBack_param,
+		computeRasterizer_param;
 
 	PF_FpLong nearBlockSize, farBlockSize,
 		minDepth, maxDepth,
 		colorizeWavesCycleRadius;
 
-	A_Boolean colorizeWaves;
+	A_Boolean colorizeWaves, occlusionCulling, sortFrontToBack, computeRasterizer;
 
 	A_long numBlocksX, numBlocksY;
 
@@ -1287,11 +2080,16 @@ PreRender(
 		in_data->time_scale,
 		&in_result));
 
+	// the depth map is only ever read through its red channel (see ExtractDepth),
+	// so upstream effects and pre-comps are free to skip the others
+	PF_RenderRequest depthReq = req;
+	depthReq.channel_mask = PF_ChannelMask_RED;
+
 	ERR(extra->cb->checkout_layer(
 		in_data->effect_ref,
 		DepthWaves_DEPTHMAP_LAYER,
 		DepthWaves_DEPTHMAP_LAYER,
-		&req,
+		&depthReq,
 		in_data->current_time,
 		in_data->time_step,
 		in_data->time_scale,
@@ -1369,6 +2167,32 @@ PreRender(
 		in_data->time_scale,
 		&colorizeWavesCycleRadius_param));
 
+	AEFX_CLR_STRUCT(occlusionCulling_param);
+
+	ERR(PF_CHECKOUT_PARAM(in_data,
+		DepthWaves_OCCLUSION_CULLING,
+		in_data->current_time,
+		in_data->time_step,
+		in_data->time_scale,
+		&occlusionCulling_param));
+
+	AEFX_CLR_STRUCT(sortFrontToBack_param);
+
+	ERR(PF_CHECKOUT_PARAM(in_data,
+		DepthWaves_SORT_FRONT_TO_BACK,
+		in_data->current_time,
+		in_data->time_step,
+		in_data->time_scale,
+		&sortFrontToBack_param));
+
+	AEFX_CLR_STRUCT(computeRasterizer_param);
+
+	ERR(PF_CHECKOUT_PARAM(in_data,
+		DepthWaves_COMPUTE_RASTERIZER,
+		in_data->current_time,
+		in_data->time_step,
+		in_data->time_scale,
+		&computeRasterizer_param));
 
 	if (!err) {
 		// other params
@@ -1382,6 +2206,9 @@ PreRender(
 		numBlocksY = (A_long)numBlocksY_param.u.fs_d.value;
 		colorizeWaves = colorizeWaves_param.u.bd.value;
 		colorizeWavesCycleRadius = colorizeWavesCycleRadius_param.u.fs_d.value;
+		occlusionCulling = occlusionCulling_param.u.bd.value;
+		sortFrontToBack = sortFrontToBack_param.u.bd.value;
+		computeRasterizer = computeRasterizer_param.u.bd.value;
 
 		ERR(GetSceneInfo(
 			in_data,
@@ -1409,10 +2236,17 @@ PreRender(
 			infoP->numWaves = waves.size();
 			infoP->colorizeWaves = colorizeWaves;
 			infoP->colorCycleRadius = colorizeWavesCycleRadius;
+			infoP->occlusionCulling = occlusionCulling;
+			infoP->sortFrontToBack = sortFrontToBack;
+			infoP->computeRasterizer = computeRasterizer;
+			infoP->lodSpritePixels = in_data->quality == PF_Quality_HI ? DepthWaves_LOD_SPRITE_PIXELS_HI : DepthWaves_LOD_SPRITE_PIXELS_LO;
 
 			if (infoP->numWaves) {
-				infoP->waves = (Wave*)malloc(waves.size() * sizeof(Wave));
-				memcpy(infoP->waves, waves.data(), waves.size() * sizeof(Wave));
+				std::vector<PackedWave> packedWaves;
+				PackWaves(waves, colorizeWaves != 0, packedWaves);
+
+				infoP->waves = (PackedWave*)malloc(packedWaves.size() * sizeof(PackedWave));
+				memcpy(infoP->waves, packedWaves.data(), packedWaves.size() * sizeof(PackedWave));
 			} else {
 				infoP->waves = NULL;
 			}
@@ -1444,6 +2278,9 @@ PreRender(
 	ERR(PF_CHECKIN_PARAM(in_data, &numBlocksY_param));
 	ERR(PF_CHECKIN_PARAM(in_data, &colorizeWaves_param));
 	ERR(PF_CHECKIN_PARAM(in_data, &colorizeWavesCycleRadius_param));
+	ERR(PF_CHECKIN_PARAM(in_data, &occlusionCulling_param));
+	ERR(PF_CHECKIN_PARAM(in_data, &sortFrontToBack_param));
+	ERR(PF_CHECKIN_PARAM(in_data, &computeRasterizer_param));
 	return err;
 }
 
@@ -1496,6 +2333,10 @@ SmartRender(
 				renderContext->mInitialized = true;
 			}
 
+			// the rest of the render uses GL, so another thread's AESDK_OpenGL_Startup waits for it;
+			// taken after our own startup, which needs the mutex exclusively
+			std::shared_lock<std::shared_timed_mutex> bindingLock(AESDK_OpenGL_GetBindingMutex());
+
 			renderContext->SetPluginContext();
 			
 			// - Gremedy OpenGL debugger
@@ -1505,17 +2346,38 @@ SmartRender(
 			A_long widthL = input_worldP->width;
 			A_long heightL = input_worldP->height;
 
+			// only the first renders after GlobalSetup can find them still linking
+			AESDK_OpenGL::AESDK_OpenGL_EffectProgramsPtr programs = GetEffectPrograms();
+
 			//loading OpenGL resources
-			AESDK_OpenGL_InitResources(*renderContext.get(), widthL, heightL, info->numBlocksX, info->numBlocksY, info->waves, info->numWaves, S_ResourcePath);
+			{
+				DW_PROFILE_STAGE("InitResources");
+				AESDK_OpenGL_InitResources(*renderContext.get(), widthL, heightL, info->numBlocksX, info->numBlocksY, info->waves, info->numWaves, programs,
+					info->occlusionCulling != 0, info->computeRasterizer != 0);
+			}
 
 			CHECK(wsP->PF_GetPixelFormat(input_worldP, &format));
 
 			// upload the input world to a texture
 			size_t pixSize;
 			gl::GLenum glFmt;
+			gl::GLenum glInternalFmt;
 			float multiplier16bit;
-			gl::GLuint colorTexture = UploadTexture(0, suites, format, input_worldP, output_worldP, in_data, pixSize, glFmt, multiplier16bit);
-			gl::GLuint depthTexture = UploadTexture(1, suites, format, depth_worldP, output_worldP, in_data, pixSize, glFmt, multiplier16bit);
+			GetPixelTransferFormat(format, pixSize, glFmt, glInternalFmt, multiplier16bit);
+
+			size_t depthChannelSize;
+			gl::GLenum glDepthInternalFmt;
+			GetDepthTransferFormat(format, depthChannelSize, glDepthInternalFmt);
+
+			// textures handed out last frame are free again
+			AESDK_OpenGL_RecycleTextures(*renderContext.get());
+
+			StagedLayer colorLayer, depthLayer;
+			StageLayers(renderContext, in_data, format, input_worldP, depth_worldP, info->numBlocksX, info->numBlocksY, pixSize, depthChannelSize, colorLayer, depthLayer);
+
+			gl::GLuint colorTexture = UploadTexture(renderContext, colorLayer, GL_RGBA, glFmt, glInternalFmt);
+			gl::GLuint depthTexture = UploadTexture(renderContext, depthLayer, GL_RED, glFmt, glDepthInternalFmt);
+			renderContext->mUploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
 			
 			// Set up the frame-buffer object just like a window.
 			AESDK_OpenGL_MakeReadyToRender(*renderContext.get(), renderContext->mOutputFrameTexture);
@@ -1525,6 +2387,8 @@ SmartRender(
 			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			
+			SetEffectParams(renderContext, widthL, heightL, info, multiplier16bit);
+
 			/*** Compute Particles ***/
 
 			if (info->numBlocksX * info->numBlocksY > 0) {
@@ -1535,14 +2399,6 @@ SmartRender(
 					info
 				);
 
-				Vertex *verts = new Vertex[info->numBlocksX * info->numBlocksY];
-				glGetNamedBufferSubData(renderContext->vertBuffer, 0, info->numBlocksX * info->numBlocksY * sizeof(Vertex), verts);
-
-				Wave *waveBuf = new Wave[info->numWaves];
-				glGetNamedBufferSubData(renderContext->waveBuffer, 0, info->numWaves * sizeof(Wave), waveBuf);
-
-				delete[] waveBuf;
-				delete[] verts;
 				RenderGL(
 					renderContext,
 					renderContext->mOutputFrameTexture,
@@ -1551,6 +2407,9 @@ SmartRender(
 					multiplier16bit
 				);
 			}
+			// fence this frame's slot of the dynamic ring behind the commands that read it
+			AESDK_OpenGL_EndDynamicFrame(*renderContext.get());
+
 			// - we toggle PBO textures (we use the PBO we just created as an input)
 			// AESDK_OpenGL_MakeReadyToRender(*renderContext.get(), colorTexture);
 			// ReportIfErrorFramebuffer(in_data, out_data);
@@ -1560,12 +2419,10 @@ SmartRender(
 			}
 
 			// - get back to CPU the result, and inside the output world
-			DownloadTexture(renderContext, suites, input_worldP, output_worldP, in_data, format, pixSize, glFmt);
+			DownloadTexture(renderContext, output_worldP, in_data, format, pixSize, glFmt);
 
 			glBindFramebuffer(GL_FRAMEBUFFER, 0);
 			glBindTexture(GL_TEXTURE_2D, 0);
-			glDeleteTextures(1, &colorTexture);
-			glDeleteTextures(1, &depthTexture);
 		}
 		catch (PF_Err& thrown_err)
 		{
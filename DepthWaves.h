@@ -69,6 +69,7 @@ typedef float				fpshort;
 #include "CameraTransform.hpp"
 #include "Impulse.h"
 #include "Wave.h"
+#include "GLSL_files/packed-wave.h"
 #include "vmath.hpp"
 
 #include <vector>
@@ -100,6 +101,9 @@ typedef float				fpshort;
 #define DepthWaves_COLORIZE_WAVES_CHECKBOX_DEFAULT			false
 #define DepthWaves_COLORIZE_WAVES_CYCLE_RADIUS_DEFAULT		0.0
 #define DepthWaves_NUM_BLOCKS_DEFAULT						50
+#define DepthWaves_OCCLUSION_CULLING_CHECKBOX_DEFAULT		false
+#define DepthWaves_SORT_FRONT_TO_BACK_CHECKBOX_DEFAULT		false
+#define DepthWaves_COMPUTE_RASTERIZER_CHECKBOX_DEFAULT		false
 
 #define DepthWaves_BLOCK_SIZE_SLIDER_MIN					0.0000
 #define DepthWaves_BLOCK_SIZE_SLIDER_MAX					1000.0
@@ -120,6 +124,16 @@ typedef float				fpshort;
 #define DepthWaves_NUM_BLOCKS_SLIDER_MIN					1
 #define DepthWaves_NUM_BLOCKS_SLIDER_MAX					2000
 
+#ifndef DepthWaves_RENDER_GEOMETRY_SHADER
+#define DepthWaves_RENDER_GEOMETRY_SHADER					0			// 1: expand points into cubes in render-blocks.geom instead of instancing
+#endif
+#define DepthWaves_COMPUTE_TILE_SIZE						8			// local_size of compute-particles.glsl
+#define DepthWaves_READBACK_STRIP_BYTES						(4 << 20)	// FBO rows read back per fence
+#define DepthWaves_LOD_SPRITE_PIXELS_HI					0.0			// blocks narrower than this on screen are drawn as point sprites rather than cubes; 0 keeps best quality identical to the cubes
+#define DepthWaves_LOD_SPRITE_PIXELS_LO					8.0			// the same in draft quality
+#define DepthWaves_MICRO_BLOCK_PIXELS						8.0			// with the compute rasterizer, blocks narrower than this on screen skip the hardware
+#define DepthWaves_OCCLUDER_DEPTH_FRACTION					0.25		// with occlusion culling, blocks this far into the depth range are drawn first as occluders
+
 enum {
 	DepthWaves_INPUT = 0,
 	DepthWaves_DEPTHMAP_LAYER,
@@ -140,6 +154,9 @@ enum {
 	DepthWaves_COLORIZE_WAVES_CYCLE_RADIUS,
 	DepthWaves_NUM_BLOCKS_X,
 	DepthWaves_NUM_BLOCKS_Y,
+	DepthWaves_OCCLUSION_CULLING,
+	DepthWaves_SORT_FRONT_TO_BACK,
+	DepthWaves_COMPUTE_RASTERIZER,
 	DepthWaves_NUM_PARAMS
 };
 
@@ -161,7 +178,10 @@ enum {
 	COLORIZE_WAVES_DISK_ID,
 	COLORIZE_WAVES_CYCLE_RADIUS_DISK_ID,
 	NUM_BLOCKS_X_DISK_ID,
-	NUM_BLOCKS_Y_DISK_ID
+	NUM_BLOCKS_Y_DISK_ID,
+	OCCLUSION_CULLING_DISK_ID,
+	SORT_FRONT_TO_BACK_DISK_ID,
+	COMPUTE_RASTERIZER_DISK_ID
 };
 
 extern "C" {
@@ -184,12 +204,17 @@ typedef struct DepthWavesInfo {
 	PF_FpLong colorCycleRadius;
 
 	A_Boolean colorizeWaves;
+	A_Boolean occlusionCulling;
+	A_Boolean sortFrontToBack;
+	A_Boolean computeRasterizer;
+
+	PF_FpLong lodSpritePixels;
 
 	A_long numBlocksX;
 	A_long numBlocksY;
 	A_long numWaves;
 
-	Wave *waves;
+	PackedWave *waves;
 
 	CameraTransform cameraTransform;
 } DepthWavesInfo, *DepthWavesInfoP, **DepthWavesInfoH;
@@ -0,0 +1,96 @@
+/*
+	DepthWaves_Profile.h
+
+	Per-stage timing and counter hooks for the SmartRender pipeline. They
+	compile to nothing unless DEPTHWAVES_PROFILE is defined, which only the
+	headless harness does; the host that defines it implements
+	DepthWaves_ReportStage, DepthWaves_ReportCounter and DepthWaves_ReportEvent.
+*/
+
+#pragma once
+
+#ifndef DepthWaves_Profile_H
+#define DepthWaves_Profile_H
+
+#ifdef DEPTHWAVES_PROFILE
+
+#include <chrono>
+
+#include "glbinding/gl45core/gl.h"
+
+void DepthWaves_ReportStage(const char *stageName, double milliseconds);
+void DepthWaves_ReportCounter(const char *counterName, double value);
+// one-off events outside the frames, such as program cache hits; called from any thread
+void DepthWaves_ReportEvent(const char *eventName);
+
+class DepthWaves_ScopedStage
+{
+public:
+	explicit DepthWaves_ScopedStage(const char *stageName) :
+		mStageName(stageName),
+		mStart(std::chrono::steady_clock::now())
+	{
+	}
+
+	~DepthWaves_ScopedStage()
+	{
+		// drain the GPU so each stage is charged with its own work
+		gl45core::glFinish();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - mStart;
+		DepthWaves_ReportStage(mStageName, elapsed.count());
+	}
+
+private:
+	const char *mStageName;
+	std::chrono::steady_clock::time_point mStart;
+
+	DepthWaves_ScopedStage(const DepthWaves_ScopedStage &);
+	DepthWaves_ScopedStage &operator=(const DepthWaves_ScopedStage &);
+};
+
+// counts the fragments that pass the depth test while in scope, i.e. the shading work
+// that reached the framebuffer; compared with the covered pixels this is the overdraw
+class DepthWaves_ScopedSamplesPassed
+{
+public:
+	explicit DepthWaves_ScopedSamplesPassed(const char *counterName) :
+		mCounterName(counterName),
+		mQuery(0)
+	{
+		gl45core::glGenQueries(1, &mQuery);
+		gl45core::glBeginQuery(gl45core::GL_SAMPLES_PASSED, mQuery);
+	}
+
+	~DepthWaves_ScopedSamplesPassed()
+	{
+		gl45core::glEndQuery(gl45core::GL_SAMPLES_PASSED);
+
+		gl::GLuint64 samples = 0;
+		gl45core::glGetQueryObjectui64v(mQuery, gl45core::GL_QUERY_RESULT, &samples);
+		gl45core::glDeleteQueries(1, &mQuery);
+
+		DepthWaves_ReportCounter(mCounterName, (double)samples);
+	}
+
+private:
+	const char *mCounterName;
+	gl::GLuint mQuery;
+
+	DepthWaves_ScopedSamplesPassed(const DepthWaves_ScopedSamplesPassed &);
+	DepthWaves_ScopedSamplesPassed &operator=(const DepthWaves_ScopedSamplesPassed &);
+};
+
+#define DW_PROFILE_STAGE(NAME)				DepthWaves_ScopedStage dwProfileStage(NAME)
+#define DW_PROFILE_SAMPLES_PASSED(NAME)		DepthWaves_ScopedSamplesPassed dwProfileSamplesPassed(NAME)
+#define DW_PROFILE_EVENT(NAME)				DepthWaves_ReportEvent(NAME)
+
+#else
+
+#define DW_PROFILE_STAGE(NAME)
+#define DW_PROFILE_SAMPLES_PASSED(NAME)
+#define DW_PROFILE_EVENT(NAME)
+
+#endif // DEPTHWAVES_PROFILE
+
+#endif // DepthWaves_Profile_H
@@ -0,0 +1,24 @@
+/*
+	DepthWaves_Shaders.h
+
+	The files of GLSL_files, compiled into the plug-in. The table itself is
+	generated at build time by GLSL_files/embed-shaders.cmake, so editing a
+	shader only needs a rebuild. ReadShaderFile looks bare file names up here;
+	setting DEPTHWAVES_SHADER_DIR reads them from that folder instead, for
+	working on the shaders without rebuilding.
+*/
+
+#pragma once
+
+#ifndef DepthWaves_Shaders_H
+#define DepthWaves_Shaders_H
+
+struct DepthWaves_EmbeddedShader {
+	const char *name;		// file name in GLSL_files
+	const char *source;
+};
+
+// sorted by name, ending with a null name
+extern const DepthWaves_EmbeddedShader DepthWaves_EmbeddedShaders[];
+
+#endif // DepthWaves_Shaders_H
@@ -49,7 +49,10 @@ TableString		g_strs[StrID_NUMTYPES] = {
 	StrID_Colorize_Waves_Checkbox_Name,				"Colorize Waves",
 	StrID_Colorize_Waves_Cycle_Radius_Slider_Name,	"Colorize Cycle Radius",
 	StrID_Num_Blocks_X_Name,						"Num Blocks (Horizontal)",
-	StrID_Num_Blocks_Y_Name,						"Num Blocks (Vertical)"
+	StrID_Num_Blocks_Y_Name,						"Num Blocks (Vertical)",
+	StrID_Occlusion_Culling_Checkbox_Name,			"Occlusion Culling",
+	StrID_Sort_Front_To_Back_Checkbox_Name,			"Sort Front To Back",
+	StrID_Compute_Rasterizer_Checkbox_Name,			"Compute Rasterizer"
 };
 
 
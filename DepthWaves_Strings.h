@@ -43,5 +43,8 @@ typedef enum {
 	StrID_Colorize_Waves_Cycle_Radius_Slider_Name,
 	StrID_Num_Blocks_X_Name,
 	StrID_Num_Blocks_Y_Name,
+	StrID_Occlusion_Culling_Checkbox_Name,
+	StrID_Sort_Front_To_Back_Checkbox_Name,
+	StrID_Compute_Rasterizer_Checkbox_Name,
 	StrID_NUMTYPES
 } StrIDType;
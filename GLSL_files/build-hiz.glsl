@@ -0,0 +1,35 @@
+#version 450
+
+// One level of the Hi-Z pyramid: each texel keeps the farthest depth under its 2x2 footprint
+// of the level above (the depth buffer for level 0). GL halves odd sizes downwards, so the
+// last row and column also take the leftover texel, and every source texel is covered.
+
+layout(binding = 0) uniform sampler2D srcDepth;
+layout(r32f, binding = 0) uniform writeonly image2D dstDepth;
+
+#include "effect-params.h"
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+void main()
+{
+	ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 dstSize = imageSize(dstDepth);
+	if (any(greaterThanEqual(dst, dstSize))) {
+		return;
+	}
+
+	// GL's level size rule, rather than textureSize with a varying lod, which llvmpipe gets wrong
+	ivec2 srcSize = max(textureSize(srcDepth, 0) >> srcLod, ivec2(1));
+	ivec2 first = 2 * dst;
+	ivec2 last = min(mix(first + 1, srcSize - 1, equal(dst, dstSize - 1)), srcSize - 1);
+
+	float farthest = 0.0;
+	for (int y = first.y; y <= last.y; ++y) {
+		for (int x = first.x; x <= last.x; ++x) {
+			farthest = max(farthest, texelFetch(srcDepth, ivec2(x, y), srcLod).r);
+		}
+	}
+
+	imageStore(dstDepth, dst, vec4(farthest));
+}
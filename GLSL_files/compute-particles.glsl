@@ -1,49 +1,95 @@
 #version 450
 #define M_PI 3.1415926535897932384626433832795
 
-vec2 uv = vec2(gl_GlobalInvocationID.xy) / vec2(gl_NumWorkGroups.xy);
+// Built in variants, with the defines AESDK_OpenGL_InitPrograms puts after the #version line:
+// HAS_WAVES when there are waves to apply, and COLORIZE_WAVES when their colour cycles with
+// the distance from their centre. Without HAS_WAVES every block keeps its pixel's colour and size.
 
-struct Vertex {
-	vec4 pos;
-	vec4 color;
-	vec4 size;
-};
+// blocks are processed in TILE_SIZE x TILE_SIZE tiles; keep in sync with DepthWaves_COMPUTE_TILE_SIZE
+#define TILE_SIZE 8
+// binned waves staged through shared memory per pass
+#define WAVE_CHUNK 64
 
-struct Wave {
-	vec4 position;
-	vec4 displacement;
-	vec4 color;
-	
-	float blockSizeMultiplier;
-	float colorMix;
-	float outerRadius;
-	float innerRadius;
+#include "effect-params.h"
+#include "packed-vertex.h"
+#include "packed-wave.h"
 
-	vec4 timeSinceBirth; // timeSinceBirth should be x
-};
+// the dispatch is rounded up to whole tiles of blockCount
+vec2 uv = vec2(gl_GlobalInvocationID.xy) / vec2(blockCount);
 
-layout(binding = 0, rgba32f) uniform readonly image2D colorTex;
-layout(binding = 1, rgba32f) uniform readonly image2D depthTex;
+// RGBA8/RGBA16/RGBA32F depending on the project, swizzled from AE's ARGB
+layout(binding = 0) uniform sampler2D colorTex;
+// R8/R16/R32F, the depth layer's red channel only
+layout(binding = 1) uniform sampler2D depthTex;
 
 layout(std430, binding = 2) buffer vertex {
 	Vertex v[];
 };
 
+#ifdef HAS_WAVES
 layout(std430, binding = 3) buffer wave {
-	Wave w[];
+	PackedWave w[];
+};
+#endif
+
+// DrawArraysIndirectCommands, an instanced-cube and a geometry-shader-point one per block list
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+
+layout(std430, binding = 4) buffer drawCommand {
+	DrawCommand draws[];
+};
+
+// compacted indices of the blocks worth drawing: those drawn straight away as cubes, the far
+// ones left for the occlusion test, the tiny ones left for rasterize-micro-blocks.glsl, and
+// the small ones drawn as point sprites
+#define DRAW_LIST 0
+#define OCCLUSION_CANDIDATE_LIST 1
+#define MICRO_BLOCK_LIST 3
+#define SPRITE_LIST 4
+#define NUM_BLOCK_LISTS 5
+
+layout(std430, binding = 5) buffer drawList {
+	uint drawBlocks[];
+};
+
+layout(std430, binding = 6) buffer occlusionCandidateList {
+	uint candidateBlocks[];
 };
 
-uniform float minDepth;
-uniform float maxDepth;
-uniform vec2 cameraFov;
-uniform int waveCount;
-uniform float nearBlockSize;
-uniform float farBlockSize;
-uniform bool colorizeWaves;
-uniform float colorCycleRadius;
+layout(std430, binding = 7) buffer microBlockList {
+	uint microBlocks[];
+};
 
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+layout(std430, binding = 8) buffer spriteList {
+	uint spriteBlocks[];
+};
 
+layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE, local_size_z = 1) in;
+
+#ifdef HAS_WAVES
+shared PackedWave sharedWaves[WAVE_CHUNK];
+shared int sharedWaveCount;
+shared int nextWave;
+
+// undisplaced block positions of this tile, and the box around them
+shared vec3 tilePoints[TILE_SIZE * TILE_SIZE];
+shared bool tilePointsInGrid[TILE_SIZE * TILE_SIZE];
+shared vec3 tileMin;
+shared vec3 tileMax;
+// how far the binned waves so far can have pushed a block out of the box
+shared float tileReach;
+#endif
+// visible blocks of this tile per list, and where they start in it; the occlusion survivor
+// list is filled by cull-occluded.glsl, so its count here stays 0
+shared uint tileListCount[NUM_BLOCK_LISTS];
+shared uint tileListStart[NUM_BLOCK_LISTS];
+
+#ifdef COLORIZE_WAVES
 vec3 hsl2rgb(vec3 HSL)
 {
   float R = abs(HSL.x * 6.0 - 3.0) - 1.0;
@@ -53,87 +99,23 @@ vec3 hsl2rgb(vec3 HSL)
   float C = (1.0 - abs(2.0 * HSL.z - 1.0)) * HSL.y;
   return (RGB - 0.5) * C + HSL.z;
 }
+#endif
 
-vec3 rgb2hsl(vec3 color) {
- 	vec3 hsl; // init to 0 to avoid warnings ? (and reverse if + remove first part)
-
- 	float fmin = min(min(color.r, color.g), color.b); //Min. value of RGB
- 	float fmax = max(max(color.r, color.g), color.b); //Max. value of RGB
- 	float delta = fmax - fmin; //Delta RGB value
-
- 	hsl.z = (fmax + fmin) / 2.0; // Luminance
-
- 	if (delta == 0.0) //This is a gray, no chroma...
- 	{
- 		hsl.x = 0.0; // Hue
- 		hsl.y = 0.0; // Saturation
- 	} else //Chromatic data...
- 	{
- 		if (hsl.z < 0.5)
- 			hsl.y = delta / (fmax + fmin); // Saturation
- 		else
- 			hsl.y = delta / (2.0 - fmax - fmin); // Saturation
-
- 		float deltaR = (((fmax - color.r) / 6.0) + (delta / 2.0)) / delta;
- 		float deltaG = (((fmax - color.g) / 6.0) + (delta / 2.0)) / delta;
- 		float deltaB = (((fmax - color.b) / 6.0) + (delta / 2.0)) / delta;
-
- 		if (color.r == fmax)
- 			hsl.x = deltaB - deltaG; // Hue
- 		else if (color.g == fmax)
- 			hsl.x = (1.0 / 3.0) + deltaR - deltaB; // Hue
- 		else if (color.b == fmax)
- 			hsl.x = (2.0 / 3.0) + deltaG - deltaR; // Hue
-
- 		if (hsl.x < 0.0)
- 			hsl.x += 1.0; // Hue
- 		else if (hsl.x > 1.0)
- 			hsl.x -= 1.0; // Hue
- 	}
-
- 	return hsl;
- }
-
-float getDepth(ivec2 inPos) {
-
-	return imageLoad(depthTex, inPos).g;
+// texel of a layer that belongs to this block; exact when the layer was pre-reduced to the block grid
+ivec2 getBlockTexel(ivec2 layerSize) {
+	return ivec2(gl_GlobalInvocationID.xy * uvec2(layerSize) / blockCount);
 }
 
-// apply 5x5 convolution kernel to smooth depth edges
-float getSmoothedDepth(ivec2 inPos)
-{
-	float kernel[5][5] = {
-		{ 1,  4,  6,  4, 1 },
-		{ 4, 16, 24, 16, 4 },
-		{ 6, 24, 36, 24, 6 },
-		{ 4, 16, 24, 16, 4 },
-		{ 1,  4,  6,  4, 1 },
-	};
-	float c = 256.f;
-
-	float depth = 0.f;
-
-	ivec2 maxPos = imageSize(depthTex) - 1;
-	ivec2 minPos = ivec2(0, 0);
-	
-	for (int i = 0; i < 5; ++i)
-	{
-		for (int j = 0; j < 5; ++j)
-		{
-			ivec2 pos = inPos - 2 + ivec2(i, j);
-			pos = clamp(pos, minPos, maxPos);
-			depth += kernel[i][j] * getDepth(pos);
-		}
-	}
+float getDepth(ivec2 inPos) {
 
-	return depth / c;
+	return texelFetch(depthTex, inPos, 0).r;
 }
 
 vec3 getWorldPosition()
 {
-	ivec2 depthImageSize = ivec2(imageSize(depthTex));
+	ivec2 depthImageSize = textureSize(depthTex, 0);
 
-	float d = getDepth(ivec2(uv * vec2(depthImageSize)));
+	float d = getDepth(getBlockTexel(depthImageSize));
 
 	float zCam = -(maxDepth + d * (minDepth - maxDepth));
 
@@ -146,67 +128,210 @@ vec3 getWorldPosition()
 	return vec4(-pos.xy, pos.z, 1.0).xyz;
 }
 
+#ifdef HAS_WAVES
+// can the shell between the inner and outer radius touch a block of this tile?
+bool waveReachesTile(PackedWave wv)
+{
+	vec3 c = wv.position.xyz;
+	float nearest = length(max(max(tileMin - c, c - tileMax), vec3(0.0)));
+	float farthest = length(max(abs(c - tileMin), abs(c - tileMax)));
+
+	return nearest <= wv.position.w + tileReach && farthest >= wv.shell.x - tileReach;
+}
+
+// Fill sharedWaves with the next waves that reach this tile, in order. A block outside a
+// wave's shell gets k == 0 from it (to float precision), so skipping those waves is safe.
+void binWaves()
+{
+	int count = 0;
+	for (; nextWave < waveCount && count < WAVE_CHUNK; ++nextWave) {
+		PackedWave wv = w[nextWave];
+		if (waveReachesTile(wv)) {
+			sharedWaves[count++] = wv;
+			tileReach += abs(wv.displacement.w);
+		}
+	}
+	sharedWaveCount = count;
+}
+#endif
+
+// Would any of the block's cube be drawn? Mirrors the corners render-blocks.geom emits,
+// including their w of 2, and drops the block when they all fall outside one clip plane.
+bool isBlockVisible(vec3 center, float size, float alpha)
+{
+	if (size == 0.0 || alpha <= 0.0) {
+		return false;
+	}
+
+	bvec3 allBelow = bvec3(true);
+	bvec3 allAbove = bvec3(true);
+	for (int i = 0; i < 8; ++i) {
+		vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = modelViewProjectionMatrix * vec4(center + corner * size, 2.0);
+		allBelow = bvec3(ivec3(allBelow) & ivec3(lessThan(clip.xyz, vec3(-clip.w))));
+		allAbove = bvec3(ivec3(allAbove) & ivec3(greaterThan(clip.xyz, vec3(clip.w))));
+	}
+
+	return !any(allBelow) && !any(allAbove);
+}
+
+// Width in pixels of the block's screen box, which picks how it is drawn. Blocks reaching
+// behind the camera count as infinitely wide.
+float getScreenExtent(vec3 center, float size)
+{
+	vec2 lo = vec2(1e30);
+	vec2 hi = vec2(-1e30);
+	for (int i = 0; i < 8; ++i) {
+		vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = modelViewProjectionMatrix * vec4(center + corner * size, 2.0);
+		if (clip.w <= 0.0) {
+			return 1.0 / 0.0;
+		}
+		vec2 win = clip.xy / clip.w * 0.5 * viewportSize;
+		lo = min(lo, win);
+		hi = max(hi, win);
+	}
+
+	vec2 extent = hi - lo;
+	return max(extent.x, extent.y);
+}
+
 void main()
 {
-	vec2 depthSizef = vec2(imageSize(depthTex));
-	vec2 colorSizef = vec2(imageSize(colorTex));
-	
+	// invocations past the grid edge only keep the tile's barriers company
+	bool inGrid = all(lessThan(gl_GlobalInvocationID.xy, blockCount));
+
 	// Step 1: Get point in space where particle is supposed to be
-	ivec2 px = ivec2(uv * colorSizef);
+	ivec2 px = getBlockTexel(textureSize(colorTex, 0));
 	vec3 point = getWorldPosition();
 	
-	vec4 pixelColor = imageLoad(colorTex, px).gbar;
-	vec4 blockColor = pixelColor;
-	float size = 1.f;
+	vec4 pixelColor = texelFetch(colorTex, px, 0);
 	float depth = length(point);
 
-	float m = (farBlockSize - nearBlockSize) / (maxDepth - minDepth);
+	// with an empty depth range every block is far size, rather than NaN
+	float depthRange = maxDepth - minDepth;
+	float m = depthRange != 0.0 ? (farBlockSize - nearBlockSize) / depthRange : 0.0;
 	float b = farBlockSize - m * maxDepth;
 	float blockSize = m * depth + b;
 
-	// Step 2: Displace point from waves
-	for (int i = 0; i < waveCount; ++i)
+	// Step 2: Bound the tile, so waves can be binned against it, and clear its list counts
+#ifdef HAS_WAVES
+	tilePoints[gl_LocalInvocationIndex] = point;
+	tilePointsInGrid[gl_LocalInvocationIndex] = inGrid;
+	barrier();
+#endif
+
+	if (gl_LocalInvocationIndex == 0) {
+#ifdef HAS_WAVES
+		tileMin = vec3(1e30);
+		tileMax = vec3(-1e30);
+		for (int i = 0; i < TILE_SIZE * TILE_SIZE; ++i) {
+			if (tilePointsInGrid[i]) {
+				tileMin = min(tileMin, tilePoints[i]);
+				tileMax = max(tileMax, tilePoints[i]);
+			}
+		}
+		tileReach = 0.0;
+		nextWave = 0;
+#endif
+		for (int l = 0; l < NUM_BLOCK_LISTS; ++l) {
+			tileListCount[l] = 0;
+		}
+	}
+
+#ifdef HAS_WAVES
+	// Step 3: Displace point from the waves binned to this tile, a shared-memory chunk at a time
+	vec4 blockColor = pixelColor;
+	float size = 1.f;
+	while (true)
 	{
-		vec3 d = point.xyz - w[i].position.xyz;
-		float lc = length(d);
-		float ir = w[i].innerRadius;
-		float or = w[i].outerRadius;
-		float r = clamp(lc, ir, or);
-		float t = (r - ir) / (or - ir);
-		float c = cos(M_PI * (t - 0.5f));
-		float k = c * c;
-
-		if (length(w[i].displacement.xyz) < 0.01) {
-			point += k * w[i].displacement.w * normalize(d);
-		} else {
-			point += k * w[i].displacement.w * normalize(w[i].displacement.xyz);
+		barrier();
+		if (gl_LocalInvocationIndex == 0) {
+			binWaves();
 		}
+		barrier();
 
-		vec4 targetColor;
-		if (colorizeWaves) {
-			vec3 hsl = rgb2hsl(w[i].color.rgb);
-			float hue = mod(lc + hsl.z, colorCycleRadius) / colorCycleRadius;
-			vec3 rgb = hsl2rgb(vec3(hue, hsl.y, hsl.z));
-			targetColor = mix(pixelColor, vec4(rgb, 1.0), w[i].colorMix);
-		} else {
-			targetColor = mix(pixelColor, w[i].color, w[i].colorMix);
+		int chunkCount = sharedWaveCount;
+		if (chunkCount == 0) {
+			break;
 		}
-		blockColor = mix(blockColor, targetColor, k);
 
-		size *= mix(1.0, w[i].blockSizeMultiplier, k);
+		for (int i = 0; i < chunkCount && inGrid; ++i)
+		{
+			PackedWave wv = sharedWaves[i];
+			vec3 d = point.xyz - wv.position.xyz;
+			float lc = length(d);
+			float t = clamp((lc - wv.shell.x) * wv.shell.y, 0.0, 1.0);
+			float c = cos(M_PI * (t - 0.5f));
+			float k = c * c;
+
+			vec3 direction = wv.displacement.xyz == vec3(0.0) ? normalize(d) : wv.displacement.xyz;
+			point += k * wv.displacement.w * direction;
+
+#ifdef COLORIZE_WAVES
+			float hue = mod(lc + wv.color.z, colorCycleRadius) / colorCycleRadius;
+			vec3 rgb = hsl2rgb(vec3(hue, wv.color.y, wv.color.z));
+			vec4 targetColor = mix(pixelColor, vec4(rgb, 1.0), wv.shell.w);
+#else
+			vec4 targetColor = mix(pixelColor, wv.color, wv.shell.w);
+#endif
+			blockColor = mix(blockColor, targetColor, k);
+
+			size *= mix(1.0, wv.shell.z, k);
+		}
 	}
 
-	size *= blockSize;
-	
+	vec4 color = blockColor.argb;
+	float cubeSize = size * blockSize;
+#else
+	// the block list counts are cleared before anyone adds to them
+	barrier();
+
+	vec4 color = pixelColor.argb;
+	float cubeSize = blockSize;
+#endif
+
 	// Set vertex coordinate
-	uint idx = gl_NumWorkGroups.y * gl_GlobalInvocationID.x + gl_GlobalInvocationID.y;
-	v[idx].pos = vec4(point, 1.0);
-
-	if (waveCount == 0) {
-		v[idx].color = pixelColor.argb;
-		v[idx].size.x = blockSize;
-	} else {
-		v[idx].color = blockColor.argb;
-		v[idx].size = vec4(size);
+	uint idx = blockCount.y * gl_GlobalInvocationID.x + gl_GlobalInvocationID.y;
+
+	if (inGrid) {
+		v[idx] = packVertex(point, cubeSize, color);
+	}
+
+	// Step 4: Append the visible blocks to their list, with one global atomic per tile and list
+	bool visible = inGrid && isBlockVisible(point, cubeSize, color.x);
+	int list = length(point) < occluderDepth ? DRAW_LIST : OCCLUSION_CANDIDATE_LIST;
+	if (visible) {
+		float extent = getScreenExtent(point, cubeSize);
+		if (extent < microBlockPixels) {
+			list = MICRO_BLOCK_LIST;
+		} else if (extent < lodSpritePixels) {
+			list = SPRITE_LIST;
+		}
+	}
+
+	uint tileSlot = 0;
+	if (visible) {
+		tileSlot = atomicAdd(tileListCount[list], 1);
+	}
+	barrier();
+
+	if (gl_LocalInvocationIndex < NUM_BLOCK_LISTS && tileListCount[gl_LocalInvocationIndex] > 0) {
+		uint l = gl_LocalInvocationIndex;
+		tileListStart[l] = atomicAdd(draws[2 * l].instanceCount, tileListCount[l]);
+		atomicAdd(draws[2 * l + 1].count, tileListCount[l]);
+	}
+	barrier();
+
+	if (visible) {
+		if (list == DRAW_LIST) {
+			drawBlocks[tileListStart[list] + tileSlot] = idx;
+		} else if (list == OCCLUSION_CANDIDATE_LIST) {
+			candidateBlocks[tileListStart[list] + tileSlot] = idx;
+		} else if (list == MICRO_BLOCK_LIST) {
+			microBlocks[tileListStart[list] + tileSlot] = idx;
+		} else {
+			spriteBlocks[tileListStart[list] + tileSlot] = idx;
+		}
 	}
 }
@@ -0,0 +1,120 @@
+#version 450
+
+// Second culling phase: tests the far blocks compute-particles set aside against the Hi-Z
+// pyramid of the near blocks already drawn, and appends the ones that may still show to
+// the survivor list.
+
+#include "effect-params.h"
+#include "packed-vertex.h"
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+
+#define OCCLUSION_CANDIDATE_LIST 1
+#define OCCLUSION_SURVIVOR_LIST 2
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+layout(std430, binding = 4) buffer drawCommand {
+	DrawCommand draws[];
+};
+
+layout(std430, binding = 6) readonly buffer occlusionCandidateList {
+	uint candidateBlocks[];
+};
+
+layout(std430, binding = 7) writeonly buffer occlusionSurvivorList {
+	uint survivorBlocks[];
+};
+
+// farthest depth per texel, level 0 at half the render size
+layout(binding = 0) uniform sampler2D hiZ;
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+shared uint groupCount;
+shared uint groupStart;
+
+// Is every pixel the block's cube could cover already nearer than the cube's nearest point?
+// The corners mirror render-blocks.geom, w of 2 included.
+bool isBlockOccluded(vec3 center, float size)
+{
+	vec2 minPx = vec2(1e30);
+	vec2 maxPx = vec2(-1e30);
+	float minZ = 1.0;
+
+	for (int i = 0; i < 8; ++i) {
+		vec3 corner = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = modelViewProjectionMatrix * vec4(center + corner * size, 2.0);
+		if (clip.w <= 0.0) {
+			// crosses the camera plane, no sound screen bounds
+			return false;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		vec2 px = (ndc.xy * 0.5 + 0.5) * viewportSize;
+		minPx = min(minPx, px);
+		maxPx = max(maxPx, px);
+		minZ = min(minZ, ndc.z * 0.5 + 0.5);
+	}
+
+	ivec2 first = ivec2(clamp(floor(minPx), vec2(0.0), viewportSize - 1.0));
+	ivec2 last = ivec2(clamp(floor(maxPx), vec2(0.0), viewportSize - 1.0));
+
+	// the coarsest level where the bounds span at most 2x2 texels; level l texels are 2^(l+1) pixels wide
+	int extent = max(last.x - first.x, last.y - first.y) + 1;
+	int levels = textureQueryLevels(hiZ);
+	int lod = clamp(int(ceil(log2(float(extent)))) - 1, 0, levels - 1);
+
+	// GL's level size rule, rather than textureSize with a varying lod, which llvmpipe gets wrong
+	ivec2 hiZSize = max(textureSize(hiZ, 0) >> lod, ivec2(1));
+	ivec2 t0 = min(first >> (lod + 1), hiZSize - 1);
+	ivec2 t1 = min(last >> (lod + 1), hiZSize - 1);
+
+	float farthest = 0.0;
+	for (int y = t0.y; y <= t1.y; ++y) {
+		for (int x = t0.x; x <= t1.x; ++x) {
+			farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), lod).r);
+		}
+	}
+
+	return minZ > farthest;
+}
+
+void main()
+{
+	if (gl_LocalInvocationIndex == 0) {
+		groupCount = 0;
+	}
+	barrier();
+
+	uint i = gl_GlobalInvocationID.x;
+	bool visible = false;
+	uint idx = 0;
+	if (i < draws[2 * OCCLUSION_CANDIDATE_LIST].instanceCount) {
+		idx = candidateBlocks[i];
+		Vertex vx = v[idx];
+		visible = !isBlockOccluded(getVertexPosition(vx), getVertexSize(vx));
+	}
+
+	uint slot = 0;
+	if (visible) {
+		slot = atomicAdd(groupCount, 1);
+	}
+	barrier();
+
+	if (gl_LocalInvocationIndex == 0 && groupCount > 0) {
+		groupStart = atomicAdd(draws[2 * OCCLUSION_SURVIVOR_LIST].instanceCount, groupCount);
+		atomicAdd(draws[2 * OCCLUSION_SURVIVOR_LIST + 1].count, groupCount);
+	}
+	barrier();
+
+	if (visible) {
+		survivorBlocks[groupStart + slot] = idx;
+	}
+}
@@ -0,0 +1,73 @@
+/*
+	effect-params.h
+
+	The std140 uniform block every pass reads the effect's parameters from.
+	SetEffectParams fills the C++ struct from DepthWavesInfo once a frame and
+	binds it with a single range of the dynamic ring; AESDK_OpenGL_ReflectProgram
+	points each program's block at that binding and checks its size against
+	the struct's. Shared with GL_base.h like packed-vertex.h.
+
+	DispatchParams carries the few values that change between the dispatches
+	of one pass. The programs are shared by every render context, so these go
+	through each context's own ring rather than default-block uniforms, which
+	would be program state that render threads race on.
+
+	Members are laid out in std140 order with no implicit padding, so the C++
+	structs match without alignment attributes.
+*/
+
+#ifndef DepthWaves_EffectParams_H
+#define DepthWaves_EffectParams_H
+
+#ifdef __cplusplus
+#define DW_BLOCK(NAME)		struct NAME
+#define DW_MAT4(NAME)		gl::GLfloat NAME[16]
+#define DW_VEC2(NAME)		gl::GLfloat NAME[2]
+#define DW_UVEC2(NAME)		gl::GLuint NAME[2]
+#define DW_FLOAT(NAME)		gl::GLfloat NAME
+#define DW_INT(NAME)		gl::GLint NAME
+#else
+#define DW_BLOCK(NAME)		layout(std140) uniform NAME
+#define DW_MAT4(NAME)		layout(row_major) mat4 NAME
+#define DW_VEC2(NAME)		vec2 NAME
+#define DW_UVEC2(NAME)		uvec2 NAME
+#define DW_FLOAT(NAME)		float NAME
+#define DW_INT(NAME)		int NAME
+#endif
+
+DW_BLOCK(EffectParams) {
+	DW_MAT4(modelViewProjectionMatrix);	// CameraTransform::projectionMatrix, row major
+	DW_VEC2(cameraFov);
+	DW_UVEC2(blockCount);				// numBlocksX, numBlocksY
+	DW_VEC2(viewportSize);				// render size in pixels
+	DW_FLOAT(minDepth);
+	DW_FLOAT(maxDepth);
+	DW_FLOAT(nearBlockSize);
+	DW_FLOAT(farBlockSize);
+	DW_FLOAT(colorCycleRadius);
+	DW_FLOAT(occluderDepth);			// blocks farther than this are occlusion tested; infinite when that is off
+	DW_FLOAT(microBlockPixels);			// blocks narrower than this on screen go to the compute rasterizer; 0 when that is off
+	DW_FLOAT(lodSpritePixels);			// blocks narrower than this are drawn as point sprites, for the render quality
+	DW_FLOAT(multiplier16bit);			// output scale for 16bpc worlds
+	DW_INT(waveCount);					// colorizing is a compute-particles.glsl variant
+	DW_FLOAT(padding0);					// round the block up to a whole vec4
+	DW_FLOAT(padding1);
+	DW_FLOAT(padding2);
+	DW_FLOAT(padding3);
+};
+
+DW_BLOCK(DispatchParams) {
+	DW_INT(srcLod);						// build-hiz.glsl: pyramid level read, or 0 for the depth buffer
+	DW_INT(sortList);					// sort-blocks.glsl: list whose draw command holds the block count
+	DW_INT(sortPass);					// sort-blocks.glsl: PASS_*
+	DW_INT(splatPass);					// rasterize-micro-blocks.glsl: depth, then block
+};
+
+#undef DW_BLOCK
+#undef DW_MAT4
+#undef DW_VEC2
+#undef DW_UVEC2
+#undef DW_FLOAT
+#undef DW_INT
+
+#endif // DepthWaves_EffectParams_H
@@ -0,0 +1,66 @@
+#
+# embed-shaders.cmake
+#
+# Writes every shader source and shared header in this folder into a C++ file
+# as string tables (DepthWaves_Shaders.h), so the plug-in never reads them from
+# disk. Run in script mode by the harness build and Win/DepthWaves.vcxproj:
+#
+#	cmake -DOUTPUT=<file.cpp> -P embed-shaders.cmake
+#
+# So the Windows build needs CMake 3.10 or later too; the vcxproj takes Visual
+# Studio's own copy when it is installed, else cmake on PATH, and DepthWavesCMake
+# overrides both. Neither build lists the shaders: a new file here only needs a
+# rebuild (and a project reload in Visual Studio).
+#
+# The sources go in as raw string literals, split so no single literal comes
+# near MSVC's length limit.
+#
+
+if (NOT OUTPUT)
+	message(FATAL_ERROR "embed-shaders.cmake: set OUTPUT to the C++ file to write")
+endif()
+
+set(CHUNK_SIZE 8000)
+
+file(GLOB SHADER_FILES RELATIVE ${CMAKE_CURRENT_LIST_DIR}
+	${CMAKE_CURRENT_LIST_DIR}/*.glsl
+	${CMAKE_CURRENT_LIST_DIR}/*.vert
+	${CMAKE_CURRENT_LIST_DIR}/*.geom
+	${CMAKE_CURRENT_LIST_DIR}/*.frag
+	${CMAKE_CURRENT_LIST_DIR}/*.h)
+list(SORT SHADER_FILES)
+
+set(CONTENTS "// Generated by GLSL_files/embed-shaders.cmake from the files next to it; do not edit.\n\n")
+string(APPEND CONTENTS "#include \"DepthWaves_Shaders.h\"\n\n")
+
+set(TABLE "")
+set(INDEX 0)
+foreach(SHADER_FILE ${SHADER_FILES})
+	file(READ ${CMAKE_CURRENT_LIST_DIR}/${SHADER_FILE} SOURCE)
+	string(LENGTH "${SOURCE}" SOURCE_LENGTH)
+
+	string(APPEND CONTENTS "static const char kShader${INDEX}[] =")
+	set(OFFSET 0)
+	while (OFFSET LESS SOURCE_LENGTH)
+		string(SUBSTRING "${SOURCE}" ${OFFSET} ${CHUNK_SIZE} CHUNK)
+		string(APPEND CONTENTS "\n\tR\"DWGLSL(${CHUNK})DWGLSL\"")
+		math(EXPR OFFSET "${OFFSET} + ${CHUNK_SIZE}")
+	endwhile()
+	if (SOURCE_LENGTH EQUAL 0)
+		string(APPEND CONTENTS " \"\"")
+	endif()
+	string(APPEND CONTENTS ";\n\n")
+
+	string(APPEND TABLE "\t{ \"${SHADER_FILE}\", kShader${INDEX} },\n")
+	math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+string(APPEND CONTENTS "const DepthWaves_EmbeddedShader DepthWaves_EmbeddedShaders[] = {\n${TABLE}\t{ 0, 0 }\n};\n")
+
+# only touch the output when it changes, so an unchanged shader set does not recompile it
+if (EXISTS ${OUTPUT})
+	file(READ ${OUTPUT} PREVIOUS)
+endif()
+if (NOT "${PREVIOUS}" STREQUAL "${CONTENTS}")
+	file(WRITE ${OUTPUT} "${CONTENTS}")
+endif()
@@ -0,0 +1,64 @@
+/*
+	packed-vertex.h
+
+	The per-block record compute-particles.glsl writes to the vertex SSBO and
+	every later pass reads. Both GL_base.h and the shaders include this file
+	(ReadShaderFile expands the shaders' includes), so the two sides cannot
+	drift apart.
+
+	24 bytes: the camera-space centre as three floats, the cube's half size as
+	a half float, and the RGBA colour as four half floats.
+*/
+
+#ifndef DepthWaves_PackedVertex_H
+#define DepthWaves_PackedVertex_H
+
+#ifdef __cplusplus
+#define DW_FLOAT	gl::GLfloat
+#define DW_UINT		gl::GLuint
+#else
+#define DW_FLOAT	float
+#define DW_UINT		uint
+#endif
+
+struct Vertex {
+	DW_FLOAT pos[3];
+	DW_UINT size;		// packHalf2x16(size, 0)
+	DW_UINT color[2];	// packHalf2x16(color.xy), packHalf2x16(color.zw)
+};
+
+#ifndef __cplusplus
+
+Vertex packVertex(vec3 pos, float size, vec4 color)
+{
+	Vertex vx;
+	vx.pos[0] = pos.x;
+	vx.pos[1] = pos.y;
+	vx.pos[2] = pos.z;
+	vx.size = packHalf2x16(vec2(size, 0.0));
+	vx.color[0] = packHalf2x16(color.xy);
+	vx.color[1] = packHalf2x16(color.zw);
+	return vx;
+}
+
+vec3 getVertexPosition(Vertex vx)
+{
+	return vec3(vx.pos[0], vx.pos[1], vx.pos[2]);
+}
+
+float getVertexSize(Vertex vx)
+{
+	return unpackHalf2x16(vx.size).x;
+}
+
+vec4 getVertexColor(Vertex vx)
+{
+	return vec4(unpackHalf2x16(vx.color[0]), unpackHalf2x16(vx.color[1]));
+}
+
+#endif
+
+#undef DW_FLOAT
+#undef DW_UINT
+
+#endif // DepthWaves_PackedVertex_H
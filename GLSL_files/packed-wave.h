@@ -0,0 +1,31 @@
+/*
+	packed-wave.h
+
+	The per-wave record compute-particles.glsl reads from the wave SSBO.
+	PackWaves fills it from the Waves GetWaves returns, working out once per
+	wave what the shader would otherwise recompute for every block: the
+	displacement direction, the reciprocal of the shell width, and the
+	colour's HSL. Shared with GL_base.h like packed-vertex.h.
+
+	64 bytes, four vec4s with no padding.
+*/
+
+#ifndef DepthWaves_PackedWave_H
+#define DepthWaves_PackedWave_H
+
+#ifdef __cplusplus
+#define DW_VEC4(NAME)	gl::GLfloat NAME[4]
+#else
+#define DW_VEC4(NAME)	vec4 NAME
+#endif
+
+struct PackedWave {
+	DW_VEC4(position);		// centre; w: outer radius
+	DW_VEC4(displacement);	// unit direction, or 0 to push blocks away from the centre; w: distance
+	DW_VEC4(color);			// RGBA, or the colour's HSL when the waves are colorized
+	DW_VEC4(shell);			// inner radius, 1 / (outer - inner radius), block size multiplier, color mix
+};
+
+#undef DW_VEC4
+
+#endif // DepthWaves_PackedWave_H
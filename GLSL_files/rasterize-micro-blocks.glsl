@@ -0,0 +1,127 @@
+#version 450
+#extension GL_ARB_gpu_shader_int64 : enable
+#extension GL_NV_shader_atomic_int64 : enable
+
+// Software rasterizer for the blocks compute-particles found to cover only a few pixels.
+// Each invocation casts the rays through the pixel centres its block's screen box covers
+// against the block's cube, and keeps the nearest hit per pixel in the visibility buffer as
+// (block index, window depth). resolve-micro-blocks.frag then shades those pixels through
+// the depth test, so they merge with the blocks drawn by the hardware.
+//
+// With 64-bit atomics, one atomicMin on the packed (depth << 32 | block) does it. Without
+// them the dispatch runs twice: pass 0 keeps the nearest depth, pass 1 the smallest block
+// index at that depth, which is what the packed minimum would have picked.
+
+#if defined(GL_ARB_gpu_shader_int64) && defined(GL_NV_shader_atomic_int64)
+#define PACKED_VISIBILITY
+#endif
+
+#define MICRO_BLOCK_LIST 3
+
+#include "effect-params.h"
+#include "packed-vertex.h"
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+layout(std430, binding = 4) readonly buffer drawCommand {
+	DrawCommand draws[];
+};
+
+layout(std430, binding = 5) readonly buffer microBlockList {
+	uint microBlocks[];
+};
+
+// per pixel, the block index in the low word and the window depth bits in the high word;
+// all ones where nothing was splatted
+#ifdef PACKED_VISIBILITY
+layout(std430, binding = 10) buffer visibility {
+	uint64_t visibleBlocks[];
+};
+#else
+layout(std430, binding = 10) buffer visibility {
+	uint visibleBlocks[];
+};
+#endif
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+void splat(uint pixel, uint depthBits, uint idx)
+{
+#ifdef PACKED_VISIBILITY
+	atomicMin(visibleBlocks[pixel], (uint64_t(depthBits) << 32) | uint64_t(idx));
+#else
+	if (splatPass == 0) {
+		atomicMin(visibleBlocks[2 * pixel + 1], depthBits);
+	} else if (visibleBlocks[2 * pixel + 1] == depthBits) {
+		atomicMin(visibleBlocks[2 * pixel], idx);
+	}
+#endif
+}
+
+void main()
+{
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= draws[2 * MICRO_BLOCK_LIST].instanceCount) {
+		return;
+	}
+
+	uint idx = microBlocks[i];
+	Vertex vx = v[idx];
+	vec3 center = getVertexPosition(vx);
+	float size = getVertexSize(vx);
+
+	// the pixels whose centres the projected corners can cover; the corners have the w of 2
+	// render-blocks.geom gives them
+	vec2 lo = vec2(1e30);
+	vec2 hi = vec2(-1e30);
+	for (int c = 0; c < 8; ++c) {
+		vec3 corner = vec3((c & 1) != 0 ? 1.0 : -1.0, (c & 2) != 0 ? 1.0 : -1.0, (c & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = modelViewProjectionMatrix * vec4(center + corner * size, 2.0);
+		vec2 win = (clip.xy / clip.w * 0.5 + 0.5) * viewportSize;
+		lo = min(lo, win);
+		hi = max(hi, win);
+	}
+	ivec2 p0 = max(ivec2(ceil(lo - 0.5)), ivec2(0));
+	ivec2 p1 = min(ivec2(floor(hi - 0.5)), ivec2(viewportSize) - 1);
+
+	vec3 boxMin = center - size;
+	vec3 boxMax = center + size;
+
+	for (int y = p0.y; y <= p1.y; ++y) {
+		for (int x = p0.x; x <= p1.x; ++x) {
+			// CameraTransform is a symmetric frustum from the origin, so this is the eye-space
+			// ray through the pixel centre
+			vec2 ndc = (vec2(x, y) + 0.5) / viewportSize * 2.0 - 1.0;
+			vec3 dir = vec3(ndc.x / modelViewProjectionMatrix[0][0], ndc.y / modelViewProjectionMatrix[1][1], -1.0);
+
+			vec3 t0 = boxMin / dir;
+			vec3 t1 = boxMax / dir;
+			vec3 tMin = min(t0, t1);
+			vec3 tMax = max(t0, t1);
+			float tNear = max(max(tMin.x, tMin.y), tMin.z);
+			float tFar = min(min(tMax.x, tMax.y), tMax.z);
+			if (tNear > tFar || tNear <= 0.0) {
+				continue;
+			}
+
+			// where the front face would have been rasterized, clipped like the hardware would
+			vec4 clip = modelViewProjectionMatrix * vec4(dir * tNear, 2.0);
+			float ndcZ = clip.z / clip.w;
+			if (abs(ndcZ) > 1.0) {
+				continue;
+			}
+
+			// window depths are positive, so their bits order like the floats
+			splat(uint(y) * uint(viewportSize.x) + uint(x), floatBitsToUint(ndcZ * 0.5 + 0.5), idx);
+		}
+	}
+}
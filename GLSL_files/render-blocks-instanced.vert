@@ -0,0 +1,49 @@
+#version 450
+
+// Instanced replacement for render-blocks.vert + render-blocks.geom: the cube strip is
+// drawn once per visible block, and the block is pulled from the buffers compute-particles writes.
+
+#include "effect-params.h"
+#include "packed-vertex.h"
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+// blocks that survived culling, one per instance
+layout(std430, binding = 5) readonly buffer visibleBlock {
+	uint visibleBlocks[];
+};
+
+out vec4 fragColor;
+
+// same strip as render-blocks.geom
+const float cube[42] = {
+    -1.f, 1.f, 1.f,     // Front-top-left
+    1.f, 1.f, 1.f,      // Front-top-right
+    -1.f, -1.f, 1.f,    // Front-bottom-left
+    1.f, -1.f, 1.f,     // Front-bottom-right
+    1.f, -1.f, -1.f,    // Back-bottom-right
+    1.f, 1.f, 1.f,      // Front-top-right
+    1.f, 1.f, -1.f,     // Back-top-right
+    -1.f, 1.f, 1.f,     // Front-top-left
+    -1.f, 1.f, -1.f,    // Back-top-left
+    -1.f, -1.f, 1.f,    // Front-bottom-left
+    -1.f, -1.f, -1.f,   // Back-bottom-left
+    1.f, -1.f, -1.f,    // Back-bottom-right
+    -1.f, 1.f, -1.f,    // Back-top-left
+    1.f, 1.f, -1.f      // Back-top-right
+};
+
+void main()
+{
+	uint idx = visibleBlocks[gl_InstanceID];
+	Vertex vx = v[idx];
+	vec4 center = vec4(getVertexPosition(vx), 1.0);
+	float size = getVertexSize(vx);
+
+	vec3 p = vec3(cube[3 * gl_VertexID], cube[3 * gl_VertexID + 1], cube[3 * gl_VertexID + 2]) * size;
+	gl_Position = modelViewProjectionMatrix * (center + vec4(p, 1.0));
+
+	fragColor = getVertexColor(vx);
+}
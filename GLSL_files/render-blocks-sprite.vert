@@ -0,0 +1,33 @@
+#version 450
+
+// Far LOD of render-blocks-instanced.vert: a block too small on screen for its sides to show
+// is drawn as one point sprite over its front face. That face is square to the camera, so
+// the sprite covers it exactly and has its depth.
+
+#include "effect-params.h"
+#include "packed-vertex.h"
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+// blocks below the LOD size, one per point
+layout(std430, binding = 5) readonly buffer visibleBlock {
+	uint visibleBlocks[];
+};
+
+out vec4 fragColor;
+
+void main()
+{
+	uint idx = visibleBlocks[gl_VertexID];
+	Vertex vx = v[idx];
+	vec4 center = vec4(getVertexPosition(vx), 1.0);
+	float size = getVertexSize(vx);
+
+	// w of 2 like the cube's corners
+	gl_Position = modelViewProjectionMatrix * vec4(center.xyz + vec3(0.0, 0.0, size), 2.0);
+	gl_PointSize = size * modelViewProjectionMatrix[0][0] * viewportSize.x / gl_Position.w;
+
+	fragColor = getVertexColor(vx);
+}
@@ -4,7 +4,7 @@ in vec4 fragColor;
 
 out vec4 outColor;
 
-uniform float multiplier16bit;
+#include "effect-params.h"
 
 void main ()  
 {  
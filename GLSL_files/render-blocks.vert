@@ -1,15 +1,24 @@
 #version 450
 
-layout (location = 0) in vec4 inVertex;
-layout (location = 1) in vec4 inColor;
-layout (location = 2) in vec4 inSize;
+#include "packed-vertex.h"
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+// blocks that survived culling, one per point
+layout(std430, binding = 5) readonly buffer visibleBlock {
+	uint visibleBlocks[];
+};
 
 out vec4 vertColor;
 out vec4 vertSize;
 
 void main()
 {
-	gl_Position = inVertex;
-	vertColor = inColor;
-	vertSize = inSize;
+	uint idx = visibleBlocks[gl_VertexID];
+	Vertex vx = v[idx];
+	gl_Position = vec4(getVertexPosition(vx), 1.0);
+	vertColor = getVertexColor(vx);
+	vertSize = vec4(getVertexSize(vx));
 }
@@ -0,0 +1,30 @@
+#version 450
+
+// Shade the pixels rasterize-micro-blocks.glsl splatted, at the depth it found, so the depth
+// test settles them against the blocks the hardware drew.
+
+#include "effect-params.h"
+#include "packed-vertex.h"
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+// block index, then window depth bits, per pixel
+layout(std430, binding = 10) readonly buffer visibility {
+	uint visibleBlocks[];
+};
+
+out vec4 outColor;
+
+void main()
+{
+	uint pixel = uint(gl_FragCoord.y) * uint(viewportSize.x) + uint(gl_FragCoord.x);
+	uint depthBits = visibleBlocks[2 * pixel + 1];
+	if (depthBits == 0xFFFFFFFFu) {
+		discard;
+	}
+
+	gl_FragDepth = uintBitsToFloat(depthBits);
+	outColor = getVertexColor(v[visibleBlocks[2 * pixel]]) / multiplier16bit;
+}
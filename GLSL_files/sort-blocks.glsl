@@ -0,0 +1,91 @@
+#version 450
+
+// Bucketed counting sort of a block list by distance from the camera, so the blocks can be
+// drawn front to back. Three passes over the same buffers: count the blocks per bucket, turn
+// the counts into bucket offsets, then scatter each block to its bucket. Blocks within one
+// bucket keep no particular order.
+
+#define SORT_BUCKETS 1024
+
+#define PASS_COUNT 0
+#define PASS_SCAN 1
+#define PASS_SCATTER 2
+
+#include "effect-params.h"
+#include "packed-vertex.h"
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+
+layout(std430, binding = 2) readonly buffer vertex {
+	Vertex v[];
+};
+
+layout(std430, binding = 4) readonly buffer drawCommand {
+	DrawCommand draws[];
+};
+
+layout(std430, binding = 5) readonly buffer unsortedList {
+	uint unsortedBlocks[];
+};
+
+layout(std430, binding = 8) writeonly buffer sortedList {
+	uint sortedBlocks[];
+};
+
+// counts, then running offsets
+layout(std430, binding = 9) buffer sortBucket {
+	uint buckets[SORT_BUCKETS];
+};
+
+layout (local_size_x = SORT_BUCKETS, local_size_y = 1, local_size_z = 1) in;
+
+shared uint scan[SORT_BUCKETS];
+
+uint getBucket(uint idx)
+{
+	// minDepth and maxDepth map onto the first and last bucket; anything outside is clamped.
+	// An empty range, the default when both sliders are left alone, has nothing to order by
+	float depthRange = maxDepth - minDepth;
+	if (depthRange == 0.0) {
+		return 0;
+	}
+	float t = (length(getVertexPosition(v[idx])) - minDepth) / depthRange;
+	return uint(clamp(t * float(SORT_BUCKETS), 0.0, float(SORT_BUCKETS - 1)));
+}
+
+void main()
+{
+	if (sortPass == PASS_SCAN) {
+		// exclusive prefix sum over the buckets, in one workgroup
+		uint i = gl_LocalInvocationIndex;
+		scan[i] = buckets[i];
+		barrier();
+
+		for (uint offset = 1; offset < SORT_BUCKETS; offset <<= 1) {
+			uint add = i >= offset ? scan[i - offset] : 0;
+			barrier();
+			scan[i] += add;
+			barrier();
+		}
+
+		buckets[i] = i == 0 ? 0 : scan[i - 1];
+		return;
+	}
+
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= draws[2 * sortList].instanceCount) {
+		return;
+	}
+
+	uint idx = unsortedBlocks[i];
+	if (sortPass == PASS_COUNT) {
+		atomicAdd(buckets[getBucket(idx)], 1);
+	} else {
+		sortedBlocks[atomicAdd(buckets[getBucket(idx)], 1)] = idx;
+	}
+}
@@ -48,11 +48,17 @@ This plugin is kept only for reference.
 #include <glbinding/AbstractFunction.h>
 
 #include <stdlib.h>
+#include <algorithm>
 #include <atomic>
 #include <sstream>
 #include <iostream>
+#include <stdio.h>
+#include <mutex>
+#include <thread>
 
 #include "Wave.h"
+#include "DepthWaves_Shaders.h"
+#include "DepthWaves_Profile.h"
 
 
 using namespace gl45core;
@@ -62,9 +68,21 @@ namespace AESDK_OpenGL
 
 	namespace {
 
+		std::shared_timed_mutex S_BindingMutex;
+
+		// glbinding identifies contexts through WGL/CGL/GLX; EGL contexts are invisible to it
+		glbinding::ContextHandle GetCurrentContextHandle()
+		{
+#ifdef AE_OS_LINUX
+			return reinterpret_cast<glbinding::ContextHandle>(eglGetCurrentContext());
+#else
+			return glbinding::getCurrentContext();
+#endif
+		}
+
 		void InitializeOpenGLBindings()
 		{
-			glbinding::Binding::initialize(false);
+			glbinding::Binding::initialize(GetCurrentContextHandle(), true, false);
 
 			// tracing (optional, disabled)
 #if 0
@@ -334,33 +352,303 @@ namespace AESDK_OpenGL
 		}
 #endif
 
-		// Allocate vertex buffer
-		GLuint CreateVertexBuffer(u_long numBlocks)
+#ifdef AE_OS_LINUX
+		EGLDisplay GetPlatformDisplay()
+		{
+			static EGLDisplay S_display = EGL_NO_DISPLAY;
+
+			if (S_display == EGL_NO_DISPLAY) {
+				// no window system on render nodes: ask Mesa for a surfaceless display first
+				PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplayEXT =
+					(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+				if (getPlatformDisplayEXT) {
+					S_display = getPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+				}
+				if (S_display == EGL_NO_DISPLAY) {
+					S_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+				}
+
+				EGLint major, minor;
+				if (S_display == EGL_NO_DISPLAY || !eglInitialize(S_display, &major, &minor)) {
+					S_display = EGL_NO_DISPLAY;
+					GL_CHECK(AESDK_OpenGL_OS_Load_Err);
+				}
+			}
+			return S_display;
+		}
+
+		EGLContext CreatePlatformContext(EGLDisplay display, EGLContext sharedContext = EGL_NO_CONTEXT)
+		{
+			// the bound API is per thread
+			if (!eglBindAPI(EGL_OPENGL_API)) {
+				GL_CHECK(AESDK_OpenGL_OS_Load_Err);
+			}
+
+			// create an OpenGL 4.5 context, without surfaces (we only ever render to FBOs)
+			EGLint attribList[] =
+			{
+				EGL_CONTEXT_MAJOR_VERSION, 4,
+				EGL_CONTEXT_MINOR_VERSION, 5,
+				EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+				EGL_NONE
+			};
+
+			EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, sharedContext, attribList);
+			if (context == EGL_NO_CONTEXT) {
+				GL_CHECK(AESDK_OpenGL_OS_Load_Err);
+			}
+
+			if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+				GL_CHECK(AESDK_OpenGL_OS_Load_Err);
+			}
+
+			return context;
+		}
+#endif
+
+		size_t GetTextureBytes(gl::GLenum internalFormat, gl::GLsizei width, gl::GLsizei height)
+		{
+			size_t texelBytes = 16;
+			switch (internalFormat)
+			{
+			case GL_RGBA32F:	texelBytes = 16; break;
+			case GL_RGBA16:		texelBytes = 8; break;
+			case GL_RGBA8:		texelBytes = 4; break;
+			case GL_R32F:		texelBytes = 4; break;
+			case GL_R16:		texelBytes = 2; break;
+			case GL_R8:			texelBytes = 1; break;
+			default:			break;
+			}
+			return texelBytes * width * height;
+		}
+
+		// drop idle textures, oldest first, until inExtraBytes more fit in the budget
+		void EvictTextures(AESDK_OpenGL_EffectRenderData& inData, size_t inExtraBytes)
 		{
-			Vertex *verts = new Vertex[numBlocks];
+			while (inData.mTexturePoolBytes + inExtraBytes > inData.mTexturePoolBudget) {
+				size_t victim = inData.mTexturePool.size();
+				for (size_t i = 0; i < inData.mTexturePool.size(); ++i) {
+					const AESDK_OpenGL_PooledTexture& entry = inData.mTexturePool[i];
+					if (!entry.inUse && (victim == inData.mTexturePool.size() || entry.lastUsedFrame < inData.mTexturePool[victim].lastUsedFrame)) {
+						victim = i;
+					}
+				}
+				if (victim == inData.mTexturePool.size()) {
+					// everything left is part of the current frame
+					break;
+				}
 
+				glDeleteTextures(1, &inData.mTexturePool[victim].texture);
+				inData.mTexturePoolBytes -= inData.mTexturePool[victim].bytes;
+				inData.mTexturePool.erase(inData.mTexturePool.begin() + victim);
+			}
+		}
+
+		// Allocate vertex buffer; compute-particles.glsl writes every block before it is read
+		GLuint CreateVertexBuffer(u_long numBlocks)
+		{
 			GLuint vbo;
 
 			glGenBuffers(1, &vbo);
 			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vbo);
-			glNamedBufferData(vbo, numBlocks * sizeof(Vertex), verts, GL_DYNAMIC_DRAW);
+			glNamedBufferData(vbo, numBlocks * sizeof(Vertex), NULL, GL_DYNAMIC_DRAW);
+
+			return vbo;
+		}
+
+		// Allocate a compacted list of block indices
+		GLuint CreateBlockListBuffer(u_long numBlocks)
+		{
+			GLuint vbo;
 
-			delete[] verts;
+			glCreateBuffers(1, &vbo);
+			glNamedBufferData(vbo, numBlocks * sizeof(gl::GLuint), NULL, GL_DYNAMIC_COPY);
 
 			return vbo;
 		}
 
-		// Allocate wave buffer
-		GLuint CreateWaveBuffer(Wave *waves, u_short numWaves)
+		// Allocate the indirect draw commands the culling passes count blocks into
+		GLuint CreateDrawCommandBuffer()
 		{
 			GLuint vbo;
 
 			glGenBuffers(1, &vbo);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, vbo);
-			glNamedBufferData(vbo, numWaves * sizeof(Wave), waves, GL_STATIC_READ);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, vbo);
+			glNamedBufferData(vbo,
+				AESDK_OpenGL_EffectRenderData::kNumBlockLists * AESDK_OpenGL_EffectRenderData::kNumDrawCommands * sizeof(DrawArraysIndirectCommand),
+				NULL, GL_DYNAMIC_COPY);
 
 			return vbo;
 		}
+
+		// Allocate the Hi-Z pyramid, from half the render size down to 1x1
+		GLuint CreateHiZTexture(u_short width, u_short height, gl::GLsizei& levels)
+		{
+			gl::GLsizei w = (std::max)(1, width / 2);
+			gl::GLsizei h = (std::max)(1, height / 2);
+
+			levels = 1;
+			for (gl::GLsizei size = (std::max)(w, h); size > 1; size /= 2) {
+				++levels;
+			}
+
+			GLuint texture;
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, levels, GL_R32F, w, h);
+			glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, (GLint)GL_NEAREST_MIPMAP_NEAREST);
+			glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, (GLint)GL_NEAREST);
+
+			return texture;
+		}
+
+		// bump whenever the file layout below changes
+		const gl::GLuint kProgramBinaryVersion = 1;
+
+		// what precedes the driver's blob in a program cache file
+		struct ProgramBinaryHeader {
+			char magic[4];			// "DWPB"
+			gl::GLuint version;		// kProgramBinaryVersion
+			gl::GLuint format;		// as glGetProgramBinary returned it
+			gl::GLint length;
+		};
+
+		// FNV-1a, enough to tell apart sources and drivers
+		void HashBytes(unsigned long long& ioHash, const void *inP, size_t inSize)
+		{
+			const unsigned char *p = reinterpret_cast<const unsigned char*>(inP);
+			for (size_t i = 0; i < inSize; ++i) {
+				ioHash ^= p[i];
+				ioHash *= 1099511628211ULL;
+			}
+		}
+
+		void HashGLString(unsigned long long& ioHash, gl::GLenum inName)
+		{
+			const gl::GLubyte *str = glGetString(inName);
+			if (str) {
+				HashBytes(ioHash, str, strlen(reinterpret_cast<const char*>(str)) + 1);
+			}
+		}
+
+		// Cache file for a program built from these sources (includes expanded) by this driver,
+		// or empty when there is no cache directory.
+		std::string GetProgramBinaryPath(const std::string& inCachePath, const char* const inSources[], int inNumSources)
+		{
+			if (inCachePath.empty()) {
+				return std::string();
+			}
+
+			unsigned long long hash = 1469598103934665603ULL;
+			HashBytes(hash, &kProgramBinaryVersion, sizeof(kProgramBinaryVersion));
+			HashGLString(hash, GL_VENDOR);
+			HashGLString(hash, GL_RENDERER);
+			HashGLString(hash, GL_VERSION);
+			for (int i = 0; i < inNumSources; ++i) {
+				// an absent stage still counts, so moving a source between stages changes the key
+				const char *source = inSources[i] ? inSources[i] : "";
+				HashBytes(hash, source, strlen(source) + 1);
+			}
+
+			char name[32];
+			snprintf(name, sizeof(name), "%016llx.bin", hash);
+			return inCachePath + name;
+		}
+
+		// A linked program from the cache file, or 0 when there is none or the driver rejects it,
+		// e.g. after a driver update that kept the version strings.
+		gl::GLuint LoadProgramBinary(const std::string& inPath)
+		{
+			if (inPath.empty()) {
+				return 0;
+			}
+
+			std::ifstream file(inPath.c_str(), std::ios::binary);
+			ProgramBinaryHeader header;
+			if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+				memcmp(header.magic, "DWPB", 4) != 0 ||
+				header.version != kProgramBinaryVersion ||
+				header.length <= 0) {
+				return 0;
+			}
+
+			std::vector<char> binary(header.length);
+			if (!file.read(&binary[0], header.length)) {
+				return 0;
+			}
+
+			GLuint program = glCreateProgram();
+			glProgramBinary(program, static_cast<gl::GLenum>(header.format), &binary[0], header.length);
+
+			GLint linkedB = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &linkedB);
+			if (!linkedB) {
+				glDeleteProgram(program);
+				return 0;
+			}
+			DW_PROFILE_EVENT("ProgramBinaryLoaded");
+			return program;
+		}
+
+		// Write a linked program to the cache. Best effort: a cache that cannot be written only
+		// costs the next context a compile. Written under a temporary name and renamed, so
+		// render threads building the same program never see half a file.
+		void SaveProgramBinary(gl::GLuint inProgram, const std::string& inPath)
+		{
+			if (inPath.empty()) {
+				return;
+			}
+
+			GLint length = 0;
+			glGetProgramiv(inProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length <= 0) {
+				// the driver offers no binary formats
+				return;
+			}
+
+			std::vector<char> binary(length);
+			gl::GLenum format;
+			glGetProgramBinary(inProgram, length, &length, &format, &binary[0]);
+
+			ProgramBinaryHeader header = { { 'D', 'W', 'P', 'B' }, kProgramBinaryVersion, static_cast<gl::GLuint>(format), length };
+
+			std::ostringstream tmpPath;
+			tmpPath << inPath << "." << std::this_thread::get_id() << ".tmp";
+			{
+				std::ofstream file(tmpPath.str().c_str(), std::ios::binary | std::ios::trunc);
+				if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+					!file.write(&binary[0], length)) {
+					file.close();
+					remove(tmpPath.str().c_str());
+					return;
+				}
+			}
+#ifdef AE_OS_WIN
+			// rename does not replace on Windows
+			remove(inPath.c_str());
+#endif
+			if (rename(tmpPath.str().c_str(), inPath.c_str()) != 0) {
+				remove(tmpPath.str().c_str());
+				return;
+			}
+			DW_PROFILE_EVENT("ProgramBinarySaved");
+		}
+
+		// Delete whatever GL objects a pending program still owns, so a build that fails leaves nothing behind
+		void DeletePendingProgram(AESDK_OpenGL_PendingProgram& ioPending)
+		{
+			for (int i = 0; i < ioPending.numShaders; ++i) {
+				if (ioPending.program) {
+					glDetachShader(ioPending.program, ioPending.shaders[i]);
+				}
+				glDeleteShader(ioPending.shaders[i]);
+			}
+			ioPending.numShaders = 0;
+
+			if (ioPending.program) {
+				glDeleteProgram(ioPending.program);
+				ioPending.program = 0;
+			}
+		}
 	} // namespace anonymous
 
 /*
@@ -377,6 +665,12 @@ namespace AESDK_OpenGL
 		ScopedAutoreleasePool pool;
 		pNSOpenGLContext_ = [NSOpenGLContext currentContext];
 		o_RC = CGLGetCurrentContext();
+#endif
+#ifdef AE_OS_LINUX
+		e_Display = eglGetCurrentDisplay();
+		e_Draw = eglGetCurrentSurface(EGL_DRAW);
+		e_Read = eglGetCurrentSurface(EGL_READ);
+		e_Context = eglGetCurrentContext();
 #endif
 	}
 
@@ -399,6 +693,17 @@ namespace AESDK_OpenGL
 			[pNSOpenGLContext_ makeCurrentContext];
 		}
 		makeCurrentFlush(o_RC);
+#endif
+#ifdef AE_OS_LINUX
+		if (e_Context != eglGetCurrentContext())
+		{
+			if (e_Context != EGL_NO_CONTEXT) {
+				eglMakeCurrent(e_Display, e_Draw, e_Read, e_Context);
+			}
+			else if (eglGetCurrentDisplay() != EGL_NO_DISPLAY) {
+				eglMakeCurrent(eglGetCurrentDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			}
+		}
 #endif
 	}
 
@@ -413,6 +718,9 @@ namespace AESDK_OpenGL
 #endif
 #ifdef AE_OS_MAC
 		, mRC(0), mNSOpenGLContext(0)
+#endif
+#ifdef AE_OS_LINUX
+		, mDisplay(EGL_NO_DISPLAY), mContext(EGL_NO_CONTEXT)
 #endif
 	{
 	}
@@ -438,6 +746,15 @@ namespace AESDK_OpenGL
 		::UnregisterClass(mClassName.c_str(), NULL);
 #elif defined(AE_OS_MAC)
 		[mNSOpenGLContext release];
+#elif defined(AE_OS_LINUX)
+		if (mContext != EGL_NO_CONTEXT)
+		{
+			if (eglGetCurrentContext() == mContext) {
+				eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			}
+			eglDestroyContext(mDisplay, mContext);
+			mContext = EGL_NO_CONTEXT;
+		}
 #endif
 	}
 
@@ -451,9 +768,11 @@ namespace AESDK_OpenGL
 		makeCurrentFlush(mRC);
 #elif defined (AE_OS_WIN)
 		wglMakeCurrent(mHDC, mHRC);
+#elif defined (AE_OS_LINUX)
+		eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, mContext);
 #endif
 
-		glbinding::Binding::useCurrentContext();
+		glbinding::Binding::useContext(GetCurrentContextHandle());
 	}
 
 
@@ -463,18 +782,48 @@ namespace AESDK_OpenGL
 
 	AESDK_OpenGL_EffectRenderData::AESDK_OpenGL_EffectRenderData() :
 		mFrameBufferSu(0),
-		mDepthRenderBufferSu(0),
+		mDepthTextureSu(0),
 		mRenderBufferWidthSu(0),
 		mRenderBufferHeightSu(0),
 		mNumBlocks(0),
+		mBlockCapacity(0),
 		mNumWaves(0),
-		computeShaderProgram(0),
-		visualShaderProgram(0),
 		mOutputFrameTexture(0),
 		vao(0),
 		vertBuffer(0),
-		waveBuffer(0)
+		drawCommandBuffer(0),
+		mSortedBlockBuffer(0),
+		mSortBucketBuffer(0),
+		mVisibilityBuffer(0),
+		mHiZTexture(0),
+		mHiZLevels(0),
+		mUploadBuffer(0),
+		mUploadBufferP(nullptr),
+		mUploadBufferSize(0),
+		mUploadFence(nullptr),
+		mDynamicBuffer(0),
+		mDynamicBufferP(nullptr),
+		mDynamicSlotSize(0),
+		mDynamicSlotUsed(0),
+		mDynamicAlignment(0),
+		mDynamicSlot(0),
+		mWaveOffset(0),
+		mEffectParamsOffset(0),
+		mReadbackBufferSize(0),
+		mTexturePoolBytes(0),
+		mTexturePoolBudget(AESDK_OpenGL_TEXTURE_POOL_BUDGET),
+		mTexturePoolFrame(0)
 	{
+		for (int i = 0; i < kReadbackRingSize; ++i) {
+			mReadbackBuffers[i] = 0;
+			mReadbackFences[i] = nullptr;
+		}
+		for (int i = 0; i < kDynamicRingSize; ++i) {
+			mDynamicFences[i] = nullptr;
+		}
+		for (int i = 0; i < kNumBlockLists; ++i) {
+			blockListBuffers[i] = 0;
+		}
 	}
 
 	AESDK_OpenGL_EffectRenderData::~AESDK_OpenGL_EffectRenderData()
@@ -486,20 +835,15 @@ namespace AESDK_OpenGL
 			glDeleteTextures(1, &mOutputFrameTexture);
 		}
 
-		//common OpenGL resource unloading
-		if (computeShaderProgram) {
-			glDeleteProgram(computeShaderProgram);
-		}
-		if (visualShaderProgram) {
-			glDeleteProgram(visualShaderProgram);
-		}
-
 		//release framebuffer resources
 		if (mFrameBufferSu) {
 			glDeleteFramebuffers(1, &mFrameBufferSu);
 		}
-		if (mDepthRenderBufferSu) {
-			glDeleteRenderbuffers(1, &mDepthRenderBufferSu);
+		if (mDepthTextureSu) {
+			glDeleteTextures(1, &mDepthTextureSu);
+		}
+		if (mHiZTexture) {
+			glDeleteTextures(1, &mHiZTexture);
 		}
 
 		if (vao) {
@@ -510,18 +854,90 @@ namespace AESDK_OpenGL
 			glDeleteBuffers(1, &vertBuffer);
 		}
 
-		if (waveBuffer) {
-			glDeleteBuffers(1, &waveBuffer);
+		for (int i = 0; i < kNumBlockLists; ++i) {
+			if (blockListBuffers[i]) {
+				glDeleteBuffers(1, &blockListBuffers[i]);
+			}
+		}
+		if (mSortedBlockBuffer) {
+			glDeleteBuffers(1, &mSortedBlockBuffer);
+		}
+		if (mSortBucketBuffer) {
+			glDeleteBuffers(1, &mSortBucketBuffer);
+		}
+		if (mVisibilityBuffer) {
+			glDeleteBuffers(1, &mVisibilityBuffer);
+		}
+
+		if (drawCommandBuffer) {
+			glDeleteBuffers(1, &drawCommandBuffer);
+		}
+
+		if (mUploadFence) {
+			glDeleteSync(mUploadFence);
+		}
+		if (mUploadBuffer) {
+			glUnmapNamedBuffer(mUploadBuffer);
+			glDeleteBuffers(1, &mUploadBuffer);
+		}
+
+		for (int i = 0; i < kDynamicRingSize; ++i) {
+			if (mDynamicFences[i]) {
+				glDeleteSync(mDynamicFences[i]);
+			}
+		}
+		if (mDynamicBuffer) {
+			glUnmapNamedBuffer(mDynamicBuffer);
+			glDeleteBuffers(1, &mDynamicBuffer);
+		}
+
+		for (int i = 0; i < kReadbackRingSize; ++i) {
+			if (mReadbackFences[i]) {
+				glDeleteSync(mReadbackFences[i]);
+			}
+			if (mReadbackBuffers[i]) {
+				glDeleteBuffers(1, &mReadbackBuffers[i]);
+			}
 		}
 
+		for (size_t i = 0; i < mTexturePool.size(); ++i) {
+			glDeleteTextures(1, &mTexturePool[i].texture);
+		}
 
 	}
 
+	/*
+	* AESDK_OpenGL_EffectPrograms
+	*/
+
+	AESDK_OpenGL_EffectPrograms::AESDK_OpenGL_EffectPrograms() :
+		visualShaderProgram(0),
+		hiZShaderProgram(0),
+		occlusionShaderProgram(0),
+		sortShaderProgram(0),
+		microRasterShaderProgram(0),
+		microResolveShaderProgram(0),
+		spriteShaderProgram(0),
+		mPackedVisibility(false)
+	{
+		for (int i = 0; i < kNumComputeVariants; ++i) {
+			computeShaderPrograms[i] = 0;
+		}
+	}
+
 	/*
 	** OS Specific windowing context creation - essential for creating the OpenGL drawing context
 	*/
+	std::shared_timed_mutex& AESDK_OpenGL_GetBindingMutex()
+	{
+		return S_BindingMutex;
+	}
+
 	void AESDK_OpenGL_Startup(AESDK_OpenGL_EffectCommonData& inData, const AESDK_OpenGL_EffectCommonData* inRootContext)
 	{
+		// no GL call may run on another thread while glbinding grows its state for this context
+		std::lock_guard<std::shared_timed_mutex> bindingLock(S_BindingMutex);
+
 #ifdef AE_OS_WIN
 		if (!inRootContext) {
 			inData.mHWnd = CreateInternalWindow(inData.mClassName);
@@ -542,6 +958,14 @@ namespace AESDK_OpenGL
 			inData.mNSOpenGLContext = createNSContext(inRootContext->mNSOpenGLContext, inData.mRC);
 		}
 		[inData.mNSOpenGLContext makeCurrentContext];
+#elif defined(AE_OS_LINUX)
+		inData.mDisplay = GetPlatformDisplay();
+		if (!inRootContext) {
+			inData.mContext = CreatePlatformContext(inData.mDisplay);
+		}
+		else {
+			inData.mContext = CreatePlatformContext(inData.mDisplay, inRootContext->mContext);
+		}
 #endif
 
 		InitializeOpenGLBindings();
@@ -556,6 +980,137 @@ namespace AESDK_OpenGL
 	{
 	}
 
+	/*
+	** Shared program loading - once, for every render context sharing inContext's objects
+	*/
+	void AESDK_OpenGL_InitPrograms(
+		AESDK_OpenGL_EffectPrograms& ioPrograms,
+		const AESDK_OpenGL_EffectCommonData& inContext,
+		const std::string& shaderPath,
+		const std::string& programCachePath,
+		bool useGeometryShader)
+	{
+		// let the driver compile on as many threads as it likes; the programs are only checked
+		// once every one of them has been issued
+		if (inContext.mExtensions.find(gl::GLextension::GL_ARB_parallel_shader_compile) != inContext.mExtensions.end()) {
+			gl::glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		}
+
+		// defines for each AESDK_OpenGL_EffectPrograms compute variant
+		const char* const computeVariantDefines[AESDK_OpenGL_EffectPrograms::kNumComputeVariants] = {
+			"",
+			"#define HAS_WAVES\n",
+			"#define HAS_WAVES\n#define COLORIZE_WAVES\n"
+		};
+
+		AESDK_OpenGL_PendingProgram compute[AESDK_OpenGL_EffectPrograms::kNumComputeVariants];
+		AESDK_OpenGL_PendingProgram hiZ, occlusion, sort, microRaster, microResolve, sprite, visual;
+		try {
+			//initialize and compile the shader objects
+			for (int i = 0; i < AESDK_OpenGL_EffectPrograms::kNumComputeVariants; ++i) {
+				compute[i] = AESDK_OpenGL_BeginComputeShader(shaderPath + "compute-particles.glsl", programCachePath, computeVariantDefines[i]);
+			}
+			hiZ = AESDK_OpenGL_BeginComputeShader(shaderPath + "build-hiz.glsl", programCachePath);
+			occlusion = AESDK_OpenGL_BeginComputeShader(shaderPath + "cull-occluded.glsl", programCachePath);
+			sort = AESDK_OpenGL_BeginComputeShader(shaderPath + "sort-blocks.glsl", programCachePath);
+			microRaster = AESDK_OpenGL_BeginComputeShader(shaderPath + "rasterize-micro-blocks.glsl", programCachePath);
+			microResolve = AESDK_OpenGL_BeginVisualShader(
+				shaderPath + "resolve-micro-blocks.vert",
+				std::string(),
+				shaderPath + "resolve-micro-blocks.frag",
+				programCachePath);
+			sprite = AESDK_OpenGL_BeginVisualShader(
+				shaderPath + "render-blocks-sprite.vert",
+				std::string(),
+				shaderPath + "render-blocks.frag",
+				programCachePath);
+			if (useGeometryShader) {
+				visual = AESDK_OpenGL_BeginVisualShader(
+					shaderPath + "render-blocks.vert",
+					shaderPath + "render-blocks.geom",
+					shaderPath + "render-blocks.frag",
+					programCachePath);
+			}
+			else {
+				visual = AESDK_OpenGL_BeginVisualShader(
+					shaderPath + "render-blocks-instanced.vert",
+					std::string(),
+					shaderPath + "render-blocks.frag",
+					programCachePath);
+			}
+
+			for (int i = 0; i < AESDK_OpenGL_EffectPrograms::kNumComputeVariants; ++i) {
+				ioPrograms.computeShaderPrograms[i] = AESDK_OpenGL_FinishProgram(compute[i]);
+			}
+			ioPrograms.hiZShaderProgram = AESDK_OpenGL_FinishProgram(hiZ);
+			ioPrograms.occlusionShaderProgram = AESDK_OpenGL_FinishProgram(occlusion);
+			ioPrograms.sortShaderProgram = AESDK_OpenGL_FinishProgram(sort);
+			ioPrograms.microRasterShaderProgram = AESDK_OpenGL_FinishProgram(microRaster);
+			ioPrograms.microResolveShaderProgram = AESDK_OpenGL_FinishProgram(microResolve);
+			ioPrograms.spriteShaderProgram = AESDK_OpenGL_FinishProgram(sprite);
+			ioPrograms.visualShaderProgram = AESDK_OpenGL_FinishProgram(visual);
+
+			// the shader picks the packed path itself when the extensions are there; the render
+			// contexts share inContext's driver, so its extensions stand for theirs
+			ioPrograms.mPackedVisibility =
+				inContext.mExtensions.find(gl::GLextension::GL_ARB_gpu_shader_int64) != inContext.mExtensions.end() &&
+				inContext.mExtensions.find(gl::GLextension::GL_NV_shader_atomic_int64) != inContext.mExtensions.end();
+
+			const gl::GLuint programs[] = {
+				ioPrograms.computeShaderPrograms[AESDK_OpenGL_EffectPrograms::kComputeNoWaves],
+				ioPrograms.computeShaderPrograms[AESDK_OpenGL_EffectPrograms::kComputeWaves],
+				ioPrograms.computeShaderPrograms[AESDK_OpenGL_EffectPrograms::kComputeColorizedWaves],
+				ioPrograms.hiZShaderProgram,
+				ioPrograms.occlusionShaderProgram,
+				ioPrograms.sortShaderProgram,
+				ioPrograms.microRasterShaderProgram,
+				ioPrograms.microResolveShaderProgram,
+				ioPrograms.spriteShaderProgram,
+				ioPrograms.visualShaderProgram
+			};
+			for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); ++i) {
+				AESDK_OpenGL_ReflectProgram(programs[i]);
+			}
+		}
+		catch (...) {
+			// the programs finished so far are in ioPrograms, the rest still pending
+			for (int i = 0; i < AESDK_OpenGL_EffectPrograms::kNumComputeVariants; ++i) {
+				DeletePendingProgram(compute[i]);
+			}
+			AESDK_OpenGL_PendingProgram* const pending[] = { &hiZ, &occlusion, &sort, &microRaster, &microResolve, &sprite, &visual };
+			for (size_t i = 0; i < sizeof(pending) / sizeof(pending[0]); ++i) {
+				DeletePendingProgram(*pending[i]);
+			}
+			AESDK_OpenGL_ReleasePrograms(ioPrograms);
+			throw;
+		}
+
+		// the render contexts only see the linked programs once this context has finished with them
+		glFinish();
+	}
+
+	void AESDK_OpenGL_ReleasePrograms(AESDK_OpenGL_EffectPrograms& ioPrograms)
+	{
+		gl::GLuint* programs[] = {
+			&ioPrograms.computeShaderPrograms[AESDK_OpenGL_EffectPrograms::kComputeNoWaves],
+			&ioPrograms.computeShaderPrograms[AESDK_OpenGL_EffectPrograms::kComputeWaves],
+			&ioPrograms.computeShaderPrograms[AESDK_OpenGL_EffectPrograms::kComputeColorizedWaves],
+			&ioPrograms.hiZShaderProgram,
+			&ioPrograms.occlusionShaderProgram,
+			&ioPrograms.sortShaderProgram,
+			&ioPrograms.microRasterShaderProgram,
+			&ioPrograms.microResolveShaderProgram,
+			&ioPrograms.spriteShaderProgram,
+			&ioPrograms.visualShaderProgram
+		};
+		for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); ++i) {
+			if (*programs[i]) {
+				glDeleteProgram(*programs[i]);
+				*programs[i] = 0;
+			}
+		}
+	}
+
 	/*
 	** OpenGL resource loading
 	*/
@@ -565,20 +1120,26 @@ namespace AESDK_OpenGL
 		u_short inBufferHeight,
 		u_short numBlocksX,
 		u_short numBlocksY,
-		Wave *waves,
+		PackedWave *waves,
 		u_short numWaves,
-		const std::string& resourcePath)
+		const AESDK_OpenGL_EffectProgramsPtr& programs,
+		bool occlusionCulling,
+		bool computeRasterizer)
 	{
 		u_long numBlocks = (u_long)numBlocksX * (u_long)numBlocksY;
 
 		bool renderSizeChangedB = inData.mRenderBufferWidthSu != inBufferWidth || inData.mRenderBufferHeightSu != inBufferHeight;
-		bool numBlocksChangedB = inData.mNumBlocks != numBlocks;
-		bool numWavesChangedB = inData.mNumWaves != numWaves;
+		// block buffers only grow, with headroom, so changing the block count does not reallocate them
+		bool blockCapacityExceededB = numBlocks > inData.mBlockCapacity;
+		if (blockCapacityExceededB) {
+			inData.mBlockCapacity = numBlocks + numBlocks / 4;
+		}
 
 		inData.mRenderBufferWidthSu = inBufferWidth;
 		inData.mRenderBufferHeightSu = inBufferHeight;
 		inData.mNumBlocks = numBlocks;
 		inData.mNumWaves = numWaves;
+		inData.mPrograms = programs;
 
 		if (renderSizeChangedB) {
 			glBindTexture(GL_TEXTURE_2D, 0);
@@ -589,9 +1150,9 @@ namespace AESDK_OpenGL
 				glDeleteFramebuffers(1, &inData.mFrameBufferSu);
 				inData.mFrameBufferSu = 0;
 			}
-			if (inData.mDepthRenderBufferSu) {
-				glDeleteRenderbuffers(1, &inData.mDepthRenderBufferSu);
-				inData.mDepthRenderBufferSu = 0;
+			if (inData.mDepthTextureSu) {
+				glDeleteTextures(1, &inData.mDepthTextureSu);
+				inData.mDepthTextureSu = 0;
 			}
 			if (inData.mOutputFrameTexture) {
 				glDeleteTextures(1, &inData.mOutputFrameTexture);
@@ -603,14 +1164,38 @@ namespace AESDK_OpenGL
 			glGenVertexArrays(1, &inData.vao);
 		}
 
-		if (numBlocksChangedB || inData.vertBuffer == 0) {
+		if (blockCapacityExceededB || inData.vertBuffer == 0) {
 			glDeleteBuffers(1, &inData.vertBuffer);
-			inData.vertBuffer = CreateVertexBuffer(numBlocks);
+			inData.vertBuffer = CreateVertexBuffer(inData.mBlockCapacity);
 		}
 
+		if (blockCapacityExceededB || inData.blockListBuffers[0] == 0) {
+			for (int i = 0; i < AESDK_OpenGL_EffectRenderData::kNumBlockLists; ++i) {
+				glDeleteBuffers(1, &inData.blockListBuffers[i]);
+				inData.blockListBuffers[i] = CreateBlockListBuffer(inData.mBlockCapacity);
+			}
+			glDeleteBuffers(1, &inData.mSortedBlockBuffer);
+			inData.mSortedBlockBuffer = CreateBlockListBuffer(inData.mBlockCapacity);
+		}
+
+		if (inData.mSortBucketBuffer == 0) {
+			glCreateBuffers(1, &inData.mSortBucketBuffer);
+			glNamedBufferData(inData.mSortBucketBuffer, AESDK_OpenGL_EffectRenderData::kSortBuckets * sizeof(gl::GLuint), NULL, GL_DYNAMIC_COPY);
+		}
+
+		if (inData.drawCommandBuffer == 0) {
+			inData.drawCommandBuffer = CreateDrawCommandBuffer();
+		}
+
+		// this frame's waves go straight into the mapped ring, fenced by the caller's AESDK_OpenGL_EndDynamicFrame;
+		// room is left for the EffectParams the caller writes next and the DispatchParams of its passes
+		gl::GLsizeiptr waveBytes = numWaves * sizeof(PackedWave);
+		AESDK_OpenGL_BeginDynamicFrame(inData,
+			waveBytes + sizeof(EffectParams) + AESDK_OpenGL_EffectRenderData::kMaxDispatchParams * sizeof(DispatchParams),
+			2 + AESDK_OpenGL_EffectRenderData::kMaxDispatchParams);
 		if (numWaves > 0) {
-			glDeleteBuffers(1, &inData.waveBuffer);
-			inData.waveBuffer = CreateWaveBuffer(waves, numWaves);
+			memcpy(AESDK_OpenGL_AllocDynamic(inData, waveBytes, inData.mWaveOffset), waves, waveBytes);
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, inData.mDynamicBuffer, inData.mWaveOffset, waveBytes);
 		}
 
 		// Create a frame-buffer object and bind it...
@@ -619,13 +1204,34 @@ namespace AESDK_OpenGL
 			glGenFramebuffers(1, &inData.mFrameBufferSu);
 			glBindFramebuffer(GL_FRAMEBUFFER, inData.mFrameBufferSu);
 
-			//now create the color render buffer
-			glGenRenderbuffers(1, &inData.mDepthRenderBufferSu);
-			glBindRenderbuffer(GL_RENDERBUFFER, inData.mDepthRenderBufferSu);
+			//now create the depth texture, a texture rather than a renderbuffer so the Hi-Z pass can read it
+			glCreateTextures(GL_TEXTURE_2D, 1, &inData.mDepthTextureSu);
+			glTextureStorage2D(inData.mDepthTextureSu, 1, GL_DEPTH_COMPONENT24, inData.mRenderBufferWidthSu, inData.mRenderBufferHeightSu);
+			glTextureParameteri(inData.mDepthTextureSu, GL_TEXTURE_MIN_FILTER, (GLint)GL_NEAREST);
+			glTextureParameteri(inData.mDepthTextureSu, GL_TEXTURE_MAG_FILTER, (GLint)GL_NEAREST);
+
+			// attach it to framebuffer
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, inData.mDepthTextureSu, 0);
+		}
+
+		// the pyramid is only kept while the mode is on, and rebuilt at the new size on a resize
+		if (inData.mHiZTexture && (renderSizeChangedB || !occlusionCulling)) {
+			glDeleteTextures(1, &inData.mHiZTexture);
+			inData.mHiZTexture = 0;
+			inData.mHiZLevels = 0;
+		}
+		if (occlusionCulling && inData.mHiZTexture == 0) {
+			inData.mHiZTexture = CreateHiZTexture(inData.mRenderBufferWidthSu, inData.mRenderBufferHeightSu, inData.mHiZLevels);
+		}
 
-			// attach renderbuffer to framebuffer
-			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, inData.mRenderBufferWidthSu, inData.mRenderBufferHeightSu);
-			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, inData.mDepthRenderBufferSu);
+		// 8 bytes a pixel, too much to keep around for a mode that is off
+		if (inData.mVisibilityBuffer && (renderSizeChangedB || !computeRasterizer)) {
+			glDeleteBuffers(1, &inData.mVisibilityBuffer);
+			inData.mVisibilityBuffer = 0;
+		}
+		if (computeRasterizer && inData.mVisibilityBuffer == 0) {
+			glCreateBuffers(1, &inData.mVisibilityBuffer);
+			glNamedBufferData(inData.mVisibilityBuffer, (gl::GLsizeiptr)inData.mRenderBufferWidthSu * inData.mRenderBufferHeightSu * sizeof(gl::GLuint64), NULL, GL_DYNAMIC_COPY);
 		}
 
 		//DepthWaves effect specific OpenGL resource loading
@@ -641,18 +1247,6 @@ namespace AESDK_OpenGL
 
 			glTexImage2D(GL_TEXTURE_2D, 0, (GLint)GL_RGBA32F, inData.mRenderBufferWidthSu, inData.mRenderBufferHeightSu, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 		}
-
-		if (inData.computeShaderProgram == 0) {
-			//initialize and compile the shader objects
-			inData.computeShaderProgram = AESDK_OpenGL_InitComputeShader(resourcePath + "compute-particles.glsl");
-		}
-		if (inData.visualShaderProgram == 0) {
-			//initialize and compile the shader objects
-			inData.visualShaderProgram = AESDK_OpenGL_InitVisualShader(
-				resourcePath + "render-blocks.vert",
-				resourcePath + "render-blocks.geom",
-				resourcePath + "render-blocks.frag");
-		}
 	}
 
 	/*
@@ -673,170 +1267,418 @@ namespace AESDK_OpenGL
 	}
 
 	/*
-	** Initialize Compute Shader
+	** Pixel-pack ring used to read the FBO back in strips
 	*/
-	gl::GLuint AESDK_OpenGL_InitComputeShader(std::string inComputeShaderFile)
+	void AESDK_OpenGL_InitReadbackRing(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inBufferSize)
 	{
-		const char *computeShaderStringsP[1];
-		GLint compCompiledB;
-		GLint linkedB;
+		// only ever grow, so moving between comps of different sizes does not thrash
+		if (inData.mReadbackBuffers[0] != 0 && inData.mReadbackBufferSize >= inBufferSize) {
+			return;
+		}
 
-		GLuint computeShaderSu = glCreateShader(GL_COMPUTE_SHADER);
+		for (int i = 0; i < AESDK_OpenGL_EffectRenderData::kReadbackRingSize; ++i) {
+			AESDK_OpenGL_WaitFence(inData.mReadbackFences[i]);
+			if (inData.mReadbackBuffers[i] == 0) {
+				glCreateBuffers(1, &inData.mReadbackBuffers[i]);
+			}
+			glNamedBufferData(inData.mReadbackBuffers[i], inBufferSize, nullptr, GL_STREAM_READ);
+		}
+		inData.mReadbackBufferSize = inBufferSize;
+	}
 
-		char str[4096];
-		unsigned char *computeShaderAssemblyP = ReadShaderFile(inComputeShaderFile);
-		if (computeShaderAssemblyP == NULL)
-		{
-			glGetShaderInfoLog(computeShaderSu, sizeof(str), NULL, str);
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+	/*
+	** Persistently mapped unpack buffer the input layers are copied into
+	*/
+	void AESDK_OpenGL_InitUploadBuffer(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inBufferSize)
+	{
+		if (inData.mUploadBuffer != 0 && inData.mUploadBufferSize >= inBufferSize) {
+			return;
 		}
 
-		computeShaderStringsP[0] = (char*)computeShaderAssemblyP;
-		glShaderSource(computeShaderSu, 1, computeShaderStringsP, NULL);
-		glCompileShader(computeShaderSu);
-		delete computeShaderAssemblyP;
+		AESDK_OpenGL_WaitFence(inData.mUploadFence);
+		if (inData.mUploadBuffer) {
+			glUnmapNamedBuffer(inData.mUploadBuffer);
+			glDeleteBuffers(1, &inData.mUploadBuffer);
+			inData.mUploadBufferP = nullptr;
+		}
 
-		glGetShaderiv(computeShaderSu, GL_COMPILE_STATUS, &compCompiledB);
-		if (!compCompiledB) {
-			glGetShaderInfoLog(computeShaderSu, sizeof(str), NULL, str);
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+		glCreateBuffers(1, &inData.mUploadBuffer);
+		glNamedBufferStorage(inData.mUploadBuffer, inBufferSize, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		inData.mUploadBufferP = glMapNamedBufferRange(inData.mUploadBuffer, 0, inBufferSize, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+		inData.mUploadBufferSize = inBufferSize;
+
+		if (!inData.mUploadBufferP) {
+			GL_CHECK(AESDK_OpenGL_Res_Load_Err);
 		}
+	}
 
-		// Create a program object and attach the compute shader
-		GLuint programObjSu = glCreateProgram();
-		glAttachShader(programObjSu, computeShaderSu);
+	/*
+	** Per-frame dynamic data - a persistently mapped ring of fenced slots
+	*/
+	void AESDK_OpenGL_BeginDynamicFrame(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inFrameBytes, int inNumAllocs)
+	{
+		if (inData.mDynamicAlignment == 0) {
+			// one alignment serves both the SSBO and the UBO ranges handed out
+			gl::GLint ssboAlignment = 0;
+			gl::GLint uboAlignment = 0;
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+			inData.mDynamicAlignment = (std::max)((std::max)(ssboAlignment, uboAlignment), 16);
+		}
 
-		// Link the program object
-		glLinkProgram(programObjSu);
-		glGetProgramiv(programObjSu, GL_LINK_STATUS, &linkedB);
+		// each allocation may start up to an alignment past where the last one ended
+		gl::GLsizeiptr frameBytes = inFrameBytes + inNumAllocs * inData.mDynamicAlignment;
 
-		if (!linkedB) {
-			glGetProgramInfoLog(programObjSu, sizeof(str), NULL, str);
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+		if (inData.mDynamicBuffer == 0 || inData.mDynamicSlotSize < frameBytes) {
+			// every slot may still be in flight
+			for (int i = 0; i < AESDK_OpenGL_EffectRenderData::kDynamicRingSize; ++i) {
+				AESDK_OpenGL_WaitFence(inData.mDynamicFences[i]);
+			}
+			if (inData.mDynamicBuffer) {
+				glUnmapNamedBuffer(inData.mDynamicBuffer);
+				glDeleteBuffers(1, &inData.mDynamicBuffer);
+				inData.mDynamicBufferP = nullptr;
+			}
+
+			// only ever grow, by doubling, so a rising wave count settles after a few frames
+			gl::GLsizeiptr slotSize = (std::max)(inData.mDynamicSlotSize, AESDK_OpenGL_DYNAMIC_SLOT_MIN);
+			while (slotSize < frameBytes) {
+				slotSize *= 2;
+			}
+			slotSize = (slotSize + inData.mDynamicAlignment - 1) / inData.mDynamicAlignment * inData.mDynamicAlignment;
+
+			gl::GLsizeiptr bufferSize = slotSize * AESDK_OpenGL_EffectRenderData::kDynamicRingSize;
+			glCreateBuffers(1, &inData.mDynamicBuffer);
+			glNamedBufferStorage(inData.mDynamicBuffer, bufferSize, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+			inData.mDynamicBufferP = reinterpret_cast<char*>(glMapNamedBufferRange(inData.mDynamicBuffer, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+			inData.mDynamicSlotSize = slotSize;
+			inData.mDynamicSlot = 0;
+
+			if (!inData.mDynamicBufferP) {
+				GL_CHECK(AESDK_OpenGL_Res_Load_Err);
+			}
+		}
+		else {
+			inData.mDynamicSlot = (inData.mDynamicSlot + 1) % AESDK_OpenGL_EffectRenderData::kDynamicRingSize;
+		}
+
+		// the frame that last wrote this slot may still be reading it
+		AESDK_OpenGL_WaitFence(inData.mDynamicFences[inData.mDynamicSlot]);
+		inData.mDynamicSlotUsed = 0;
+	}
+
+	void* AESDK_OpenGL_AllocDynamic(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inBytes, gl::GLintptr& outOffset)
+	{
+		gl::GLsizeiptr start = (inData.mDynamicSlotUsed + inData.mDynamicAlignment - 1) / inData.mDynamicAlignment * inData.mDynamicAlignment;
+		if (start + inBytes > inData.mDynamicSlotSize) {
+			GL_CHECK(AESDK_OpenGL_Res_Load_Err);
 		}
+		inData.mDynamicSlotUsed = start + inBytes;
 
-		glDetachShader(programObjSu, computeShaderSu);
-		glDeleteShader(computeShaderSu);
+		outOffset = inData.mDynamicSlot * inData.mDynamicSlotSize + start;
+		return inData.mDynamicBufferP + outOffset;
+	}
 
-		return programObjSu;
+	void AESDK_OpenGL_EndDynamicFrame(AESDK_OpenGL_EffectRenderData& inData)
+	{
+		if (inData.mDynamicBuffer) {
+			inData.mDynamicFences[inData.mDynamicSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
+		}
 	}
 
 	/*
-	** Initializing the Shader objects
+	** Texture pool - immutable storage, matched on size and internal format
 	*/
-	gl::GLuint AESDK_OpenGL_InitVisualShader(std::string inVertexShaderFile, std::string inGeometryShaderFile, std::string inFragmentShaderFile)
-	{
-		const char *vertexShaderStringsP[1];
-		const char *fragmentShaderStringsP[1];
-		const char *geometryShaderStringsP[1];
-		GLint vertCompiledB;
-		GLint geomCompiledB;
-		GLint fragCompiledB;
-		GLint linkedB;
+	gl::GLuint AESDK_OpenGL_AcquireTexture(
+		AESDK_OpenGL_EffectRenderData& inData,
+		gl::GLenum inInternalFormat,
+		gl::GLsizei inWidth,
+		gl::GLsizei inHeight)
+	{
+		for (size_t i = 0; i < inData.mTexturePool.size(); ++i) {
+			AESDK_OpenGL_PooledTexture& entry = inData.mTexturePool[i];
+			if (!entry.inUse && entry.internalFormat == inInternalFormat && entry.width == inWidth && entry.height == inHeight) {
+				entry.inUse = true;
+				entry.lastUsedFrame = inData.mTexturePoolFrame;
+				return entry.texture;
+			}
+		}
 
-		// Create the vertex shader...
-		GLuint vertexShaderSu = glCreateShader(GL_VERTEX_SHADER);
+		AESDK_OpenGL_PooledTexture entry;
+		entry.internalFormat = inInternalFormat;
+		entry.width = inWidth;
+		entry.height = inHeight;
+		entry.bytes = GetTextureBytes(inInternalFormat, inWidth, inHeight);
+		entry.inUse = true;
+		entry.lastUsedFrame = inData.mTexturePoolFrame;
 
-		unsigned char* vertexShaderAssemblyP = ReadShaderFile(inVertexShaderFile);
-		if (vertexShaderAssemblyP == NULL) {
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
-		}
+		EvictTextures(inData, entry.bytes);
 
-		vertexShaderStringsP[0] = (char*)vertexShaderAssemblyP;
-		glShaderSource(vertexShaderSu, 1, vertexShaderStringsP, NULL);
-		glCompileShader(vertexShaderSu);
-		delete vertexShaderAssemblyP;
+		glCreateTextures(GL_TEXTURE_2D, 1, &entry.texture);
+		glTextureStorage2D(entry.texture, 1, inInternalFormat, inWidth, inHeight);
 
-		glGetShaderiv(vertexShaderSu, GL_COMPILE_STATUS, &vertCompiledB);
-		char str[4096];
-		if (!vertCompiledB) {
-			glGetShaderInfoLog(vertexShaderSu, sizeof(str), NULL, str);
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+		glTextureParameteri(entry.texture, GL_TEXTURE_MAG_FILTER, (GLint)GL_LINEAR);
+		glTextureParameteri(entry.texture, GL_TEXTURE_MIN_FILTER, (GLint)GL_LINEAR);
+		glTextureParameteri(entry.texture, GL_TEXTURE_WRAP_S, (GLint)GL_CLAMP_TO_EDGE);
+		glTextureParameteri(entry.texture, GL_TEXTURE_WRAP_T, (GLint)GL_CLAMP_TO_EDGE);
+
+		// four-channel textures hold AE's ARGB pixels as-is; present them to the shaders as RGBA
+		if (inInternalFormat == GL_RGBA32F || inInternalFormat == GL_RGBA16 || inInternalFormat == GL_RGBA8) {
+			const GLint argbSwizzle[4] = { (GLint)GL_GREEN, (GLint)GL_BLUE, (GLint)GL_ALPHA, (GLint)GL_RED };
+			glTextureParameteriv(entry.texture, GL_TEXTURE_SWIZZLE_RGBA, argbSwizzle);
 		}
 
-		// Create the geometry shader...
-		GLuint geometryShaderSu = glCreateShader(GL_GEOMETRY_SHADER);
+		inData.mTexturePool.push_back(entry);
+		inData.mTexturePoolBytes += entry.bytes;
 
-		unsigned char* geometryShaderAssemblyP = ReadShaderFile(inGeometryShaderFile);
-		if (geometryShaderAssemblyP == NULL) {
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+		return entry.texture;
+	}
+
+	// hand every texture of the previous frame back to the pool
+	void AESDK_OpenGL_RecycleTextures(AESDK_OpenGL_EffectRenderData& inData)
+	{
+		for (size_t i = 0; i < inData.mTexturePool.size(); ++i) {
+			inData.mTexturePool[i].inUse = false;
 		}
+		++inData.mTexturePoolFrame;
 
-		geometryShaderStringsP[0] = (char*)geometryShaderAssemblyP;
-		glShaderSource(geometryShaderSu, 1, geometryShaderStringsP, NULL);
-		glCompileShader(geometryShaderSu);
-		delete geometryShaderAssemblyP;
+		EvictTextures(inData, 0);
+	}
 
-		glGetShaderiv(geometryShaderSu, GL_COMPILE_STATUS, &geomCompiledB);
-		if (!geomCompiledB) {
-			glGetShaderInfoLog(geometryShaderSu, sizeof(str), NULL, str);
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+	void AESDK_OpenGL_WaitFence(gl::GLsync& ioFence)
+	{
+		if (!ioFence) {
+			return;
 		}
 
-		// Create the fragment shader...
-		GLuint fragmentShaderSu = glCreateShader(GL_FRAGMENT_SHADER);
+		// the first wait flushes, so the fence is guaranteed to signal eventually
+		gl::GLenum waitResult = glClientWaitSync(ioFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		while (waitResult == GL_TIMEOUT_EXPIRED) {
+			waitResult = glClientWaitSync(ioFence, GL_NONE_BIT, 1000000000);
+		}
+		glDeleteSync(ioFence);
+		ioFence = nullptr;
 
-		unsigned char* fragmentShaderAssemblyP = ReadShaderFile(inFragmentShaderFile);
-		if (fragmentShaderAssemblyP == NULL)
-			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+		if (waitResult == GL_WAIT_FAILED) {
+			GL_CHECK(AESDK_OpenGL_Res_Load_Err);
+		}
+	}
 
-		fragmentShaderStringsP[0] = (char*)fragmentShaderAssemblyP;
-		glShaderSource(fragmentShaderSu, 1, fragmentShaderStringsP, NULL);
-		glCompileShader(fragmentShaderSu);
-		delete fragmentShaderAssemblyP;
+	/*
+	** Initialize Compute Shader
+	*/
+	gl::GLuint AESDK_OpenGL_InitComputeShader(std::string inComputeShaderFile, const std::string& inProgramCachePath, const std::string& inDefines)
+	{
+		AESDK_OpenGL_PendingProgram pending = AESDK_OpenGL_BeginComputeShader(inComputeShaderFile, inProgramCachePath, inDefines);
+		return AESDK_OpenGL_FinishProgram(pending);
+	}
+
+	AESDK_OpenGL_PendingProgram AESDK_OpenGL_BeginComputeShader(std::string inComputeShaderFile, const std::string& inProgramCachePath, const std::string& inDefines)
+	{
+		AESDK_OpenGL_PendingProgram pending;
+		const char *computeShaderStringsP[1];
 
-		glGetShaderiv(fragmentShaderSu, GL_COMPILE_STATUS, &fragCompiledB);
-		if (!fragCompiledB) {
-			glGetShaderInfoLog(fragmentShaderSu, sizeof(str), NULL, str);
+		unsigned char *computeShaderAssemblyP = ReadShaderFile(inComputeShaderFile);
+		if (computeShaderAssemblyP == NULL)
+		{
 			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
 		}
+		if (!inDefines.empty()) {
+			computeShaderAssemblyP = InsertShaderDefines(computeShaderAssemblyP, inDefines);
+		}
+		computeShaderStringsP[0] = (char*)computeShaderAssemblyP;
 
-		// Create a program object and attach the three compiled shaders...
-		GLuint programObjSu = glCreateProgram();
-		glAttachShader(programObjSu, vertexShaderSu);
-		glAttachShader(programObjSu, geometryShaderSu);
-		glAttachShader(programObjSu, fragmentShaderSu);
+		// a context that already built this program on this driver left its binary behind
+		pending.binaryPath = GetProgramBinaryPath(inProgramCachePath, computeShaderStringsP, 1);
+		pending.program = LoadProgramBinary(pending.binaryPath);
+		if (pending.program) {
+			delete[] computeShaderAssemblyP;
+			return pending;
+		}
 
-		glBindAttribLocation(programObjSu, PositionSlot, "inVertex");
-		glBindAttribLocation(programObjSu, ColorSlot, "inColor");
+		GLuint computeShaderSu = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(computeShaderSu, 1, computeShaderStringsP, NULL);
+		glCompileShader(computeShaderSu);
+		delete[] computeShaderAssemblyP;
+		pending.shaders[pending.numShaders++] = computeShaderSu;
 
-		// Set Geometry Shader properties
-		glProgramParameteri(programObjSu, GL_GEOMETRY_INPUT_TYPE, (gl::GLint)GL_POINTS);
-		glProgramParameteri(programObjSu, GL_GEOMETRY_OUTPUT_TYPE, (gl::GLint)GL_TRIANGLE_STRIP);
-		glProgramParameteri(programObjSu, GL_GEOMETRY_VERTICES_OUT, 14);
+		// Create a program object and attach the compute shader
+		pending.program = glCreateProgram();
+		glAttachShader(pending.program, computeShaderSu);
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, (gl::GLint)GL_TRUE);
+
+		// Link the program object; AESDK_OpenGL_FinishProgram checks how it went
+		glLinkProgram(pending.program);
+
+		return pending;
+	}
 
-		// Link the program object
-		glLinkProgram(programObjSu);
-		glGetProgramiv(programObjSu, GL_LINK_STATUS, &linkedB);
+	gl::GLuint AESDK_OpenGL_FinishProgram(AESDK_OpenGL_PendingProgram& ioPending)
+	{
+		// the program belongs to the caller from here on, or is gone when it did not build
+		gl::GLuint program = ioPending.program;
+		if (ioPending.numShaders == 0) {
+			// loaded from the binary cache, and linked already
+			ioPending.program = 0;
+			return program;
+		}
 
+		char str[4096];
+		for (int i = 0; i < ioPending.numShaders; ++i) {
+			GLint compiledB;
+			glGetShaderiv(ioPending.shaders[i], GL_COMPILE_STATUS, &compiledB);
+			if (!compiledB) {
+				glGetShaderInfoLog(ioPending.shaders[i], sizeof(str), NULL, str);
+				DeletePendingProgram(ioPending);
+				GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+			}
+		}
+
+		GLint linkedB;
+		glGetProgramiv(program, GL_LINK_STATUS, &linkedB);
 		if (!linkedB) {
-			glGetProgramInfoLog(programObjSu, sizeof(str), NULL, str);
+			glGetProgramInfoLog(program, sizeof(str), NULL, str);
+			DeletePendingProgram(ioPending);
 			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
 		}
 
-		glDetachShader(programObjSu, vertexShaderSu);
-		glDetachShader(programObjSu, geometryShaderSu);
-		glDetachShader(programObjSu, fragmentShaderSu);
-		glDeleteShader(vertexShaderSu);
-		glDeleteShader(geometryShaderSu);
-		glDeleteShader(fragmentShaderSu);
+		for (int i = 0; i < ioPending.numShaders; ++i) {
+			glDetachShader(program, ioPending.shaders[i]);
+			glDeleteShader(ioPending.shaders[i]);
+		}
+		ioPending.numShaders = 0;
+		ioPending.program = 0;
+		DW_PROFILE_EVENT("ProgramCompiled");
+
+		SaveProgramBinary(program, ioPending.binaryPath);
 
-		return programObjSu;
+		return program;
 	}
 
 	/*
-	** Bind Texture
+	** Program reflection - done once per linked program, before any render context uses it
 	*/
-	void AESDK_OpenGL_BindTextureToTarget(gl::GLuint program, GLint inTexture, std::string inTargetName)
+	void AESDK_OpenGL_ReflectProgram(gl::GLuint program)
 	{
-		if (inTexture != -1) {
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, inTexture);
-			glUniform1i(glGetUniformLocation(program, inTargetName.c_str()), 0);
+		// point each effect-params.h block at its binding, and refuse one that does not match the C++ struct
+		struct {
+			const char *name;
+			gl::GLint size;
+			gl::GLuint binding;
+		} const blocks[] = {
+			{ "EffectParams", (gl::GLint)sizeof(EffectParams), AESDK_OpenGL_EffectPrograms::kEffectParamsBinding },
+			{ "DispatchParams", (gl::GLint)sizeof(DispatchParams), AESDK_OpenGL_EffectPrograms::kDispatchParamsBinding }
+		};
+		for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); ++i) {
+			gl::GLuint blockIndex = glGetProgramResourceIndex(program, GL_UNIFORM_BLOCK, blocks[i].name);
+			if (blockIndex == GL_INVALID_INDEX) {
+				continue;
+			}
+			const gl::GLenum sizeProp = GL_BUFFER_DATA_SIZE;
+			gl::GLint blockSize = 0;
+			glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, blockIndex, 1, &sizeProp, 1, NULL, &blockSize);
+			if (blockSize != blocks[i].size) {
+				GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+			}
+			glUniformBlockBinding(program, blockIndex, blocks[i].binding);
 		}
-		else {
+	}
+
+	/*
+	** Initializing the Shader objects
+	*/
+	gl::GLuint AESDK_OpenGL_InitVisualShader(std::string inVertexShaderFile, std::string inGeometryShaderFile, std::string inFragmentShaderFile, const std::string& inProgramCachePath)
+	{
+		AESDK_OpenGL_PendingProgram pending = AESDK_OpenGL_BeginVisualShader(inVertexShaderFile, inGeometryShaderFile, inFragmentShaderFile, inProgramCachePath);
+		return AESDK_OpenGL_FinishProgram(pending);
+	}
+
+	AESDK_OpenGL_PendingProgram AESDK_OpenGL_BeginVisualShader(std::string inVertexShaderFile, std::string inGeometryShaderFile, std::string inFragmentShaderFile, const std::string& inProgramCachePath)
+	{
+		AESDK_OpenGL_PendingProgram pending;
+
+		// vertex, geometry (NULL when there is none) and fragment sources
+		const char *shaderStringsP[3] = { NULL, NULL, NULL };
+
+		unsigned char* vertexShaderAssemblyP = ReadShaderFile(inVertexShaderFile);
+		if (vertexShaderAssemblyP == NULL) {
+			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+		}
+		shaderStringsP[0] = (char*)vertexShaderAssemblyP;
+
+		unsigned char* geometryShaderAssemblyP = NULL;
+		if (!inGeometryShaderFile.empty()) {
+			geometryShaderAssemblyP = ReadShaderFile(inGeometryShaderFile);
+			if (geometryShaderAssemblyP == NULL) {
+				delete[] vertexShaderAssemblyP;
+				GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
+			}
+			shaderStringsP[1] = (char*)geometryShaderAssemblyP;
+		}
+
+		unsigned char* fragmentShaderAssemblyP = ReadShaderFile(inFragmentShaderFile);
+		if (fragmentShaderAssemblyP == NULL) {
+			delete[] vertexShaderAssemblyP;
+			delete[] geometryShaderAssemblyP;
 			GL_CHECK(AESDK_OpenGL_ShaderInit_Err);
 		}
+		shaderStringsP[2] = (char*)fragmentShaderAssemblyP;
+
+		// a context that already built this program on this driver left its binary behind
+		pending.binaryPath = GetProgramBinaryPath(inProgramCachePath, shaderStringsP, 3);
+		pending.program = LoadProgramBinary(pending.binaryPath);
+		if (pending.program) {
+			delete[] vertexShaderAssemblyP;
+			delete[] geometryShaderAssemblyP;
+			delete[] fragmentShaderAssemblyP;
+			return pending;
+		}
+
+		// Create the vertex shader...
+		GLuint vertexShaderSu = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShaderSu, 1, &shaderStringsP[0], NULL);
+		glCompileShader(vertexShaderSu);
+		delete[] vertexShaderAssemblyP;
+		pending.shaders[pending.numShaders++] = vertexShaderSu;
+
+		// Create the geometry shader, if there is one...
+		GLuint geometryShaderSu = 0;
+		if (geometryShaderAssemblyP) {
+			geometryShaderSu = glCreateShader(GL_GEOMETRY_SHADER);
+			glShaderSource(geometryShaderSu, 1, &shaderStringsP[1], NULL);
+			glCompileShader(geometryShaderSu);
+			delete[] geometryShaderAssemblyP;
+			pending.shaders[pending.numShaders++] = geometryShaderSu;
+		}
+
+		// Create the fragment shader...
+		GLuint fragmentShaderSu = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShaderSu, 1, &shaderStringsP[2], NULL);
+		glCompileShader(fragmentShaderSu);
+		delete[] fragmentShaderAssemblyP;
+		pending.shaders[pending.numShaders++] = fragmentShaderSu;
+
+		// Create a program object and attach the compiled shaders...
+		pending.program = glCreateProgram();
+		for (int i = 0; i < pending.numShaders; ++i) {
+			glAttachShader(pending.program, pending.shaders[i]);
+		}
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, (gl::GLint)GL_TRUE);
+
+		glBindAttribLocation(pending.program, PositionSlot, "inVertex");
+		glBindAttribLocation(pending.program, ColorSlot, "inColor");
+
+		// Set Geometry Shader properties
+		if (geometryShaderSu) {
+			glProgramParameteri(pending.program, GL_GEOMETRY_INPUT_TYPE, (gl::GLint)GL_POINTS);
+			glProgramParameteri(pending.program, GL_GEOMETRY_OUTPUT_TYPE, (gl::GLint)GL_TRIANGLE_STRIP);
+			glProgramParameteri(pending.program, GL_GEOMETRY_VERTICES_OUT, 14);
+		}
+
+		// Link the program object; AESDK_OpenGL_FinishProgram checks how it went
+		glLinkProgram(pending.program);
+
+		return pending;
 	}
 
 	/*
@@ -887,25 +1729,46 @@ namespace AESDK_OpenGL
 
 	/*
 	** ReadShaderFile
+	** A bare file name comes from the sources embedded by GLSL_files/embed-shaders.cmake; a path
+	** is read from disk, for the DEPTHWAVES_SHADER_DIR override.
+	** #include "file" lines are replaced by that file, looked up next to the including one,
+	** so the shaders can share headers such as packed-vertex.h with the C++ side
 	*/
 	unsigned char *ReadShaderFile(std::string inFilename)
 	{
-		FILE *fileP;
 		unsigned char *bufferP = NULL;
+		std::string::size_type dirEnd = inFilename.find_last_of("/\\");
+
+		if (dirEnd == std::string::npos) {
+			for (const DepthWaves_EmbeddedShader *shaderP = DepthWaves_EmbeddedShaders; shaderP->name; ++shaderP) {
+				if (inFilename == shaderP->name) {
+					size_t length = strlen(shaderP->source);
+					bufferP = new unsigned char[length + 1];
+					memcpy(bufferP, shaderP->source, length + 1);
+					break;
+				}
+			}
+		} else {
+			FILE *fileP;
 #ifdef AE_OS_WIN
-		fopen_s(&fileP, inFilename.c_str(), "r");
-#elif defined(AE_OS_MAC)
-		fileP = fopen(inFilename.c_str(), "r");
+			fopen_s(&fileP, inFilename.c_str(), "r");
+#else
+			fileP = fopen(inFilename.c_str(), "r");
 #endif	
-		if (NULL != fileP)
-		{
-			fseek(fileP, 0L, SEEK_END);
-			int32_t fileLength = ftell(fileP);
-			rewind(fileP);
-			bufferP = new unsigned char[fileLength + 1];
-			int32_t bytes = static_cast<int32_t>(fread(bufferP, 1, fileLength, fileP));
-			bufferP[bytes] = 0;
+			if (NULL != fileP)
+			{
+				fseek(fileP, 0L, SEEK_END);
+				int32_t fileLength = ftell(fileP);
+				rewind(fileP);
+				bufferP = new unsigned char[fileLength + 1];
+				int32_t bytes = static_cast<int32_t>(fread(bufferP, 1, fileLength, fileP));
+				bufferP[bytes] = 0;
+				fclose(fileP);
+			}
+		}
 
+		if (NULL != bufferP)
+		{
 #if defined(AE_OS_WIN) && defined(_DEBUG)
 			OutputDebugStringA((const char*)bufferP);
 			OutputDebugStringA("\n");
@@ -913,9 +1776,57 @@ namespace AESDK_OpenGL
 #if defined(AE_OS_MAC) && defined(_DEBUG)
 			std::cout << bufferP << std::endl;
 #endif
+
+			std::string source(reinterpret_cast<char*>(bufferP));
+			std::string dir = dirEnd == std::string::npos ? std::string() : inFilename.substr(0, dirEnd + 1);
+
+			const std::string directive("#include \"");
+			bool expandedB = false;
+			std::string::size_type pos = 0;
+			while ((pos = source.find(directive, pos)) != std::string::npos) {
+				std::string::size_type nameStart = pos + directive.length();
+				std::string::size_type nameEnd = source.find('"', nameStart);
+				if (nameEnd == std::string::npos) {
+					break;
+				}
+
+				unsigned char *includedP = ReadShaderFile(dir + source.substr(nameStart, nameEnd - nameStart));
+				if (includedP == NULL) {
+					delete[] bufferP;
+					return NULL;
+				}
+				std::string included(reinterpret_cast<char*>(includedP));
+				delete[] includedP;
+
+				source.replace(pos, nameEnd + 1 - pos, included);
+				pos += included.length();
+				expandedB = true;
+			}
+
+			if (expandedB) {
+				delete[] bufferP;
+				bufferP = new unsigned char[source.length() + 1];
+				memcpy(bufferP, source.c_str(), source.length() + 1);
+			}
 		}
 
 		return bufferP;
 	}
 
+	unsigned char* InsertShaderDefines(unsigned char* inSourceP, const std::string& inDefines)
+	{
+		std::string source(reinterpret_cast<char*>(inSourceP));
+		delete[] inSourceP;
+
+		// nothing but comments may come before #version, so the defines go on the line after it
+		std::string::size_type pos = source.find("#version");
+		pos = pos == std::string::npos ? 0 : source.find('\n', pos);
+		pos = pos == std::string::npos ? source.length() : pos + 1;
+		source.insert(pos, inDefines);
+
+		unsigned char* bufferP = new unsigned char[source.length() + 1];
+		memcpy(bufferP, source.c_str(), source.length() + 1);
+		return bufferP;
+	}
+
 } //namespace ends
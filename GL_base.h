@@ -68,15 +68,25 @@ This plugin is kept only for reference.
 #ifdef AE_OS_MAC
 	#import <Cocoa/Cocoa.h>
 #endif
+#ifdef AE_OS_LINUX
+	// headless EGL (surfaceless Mesa), used by the render harness
+	#define EGL_NO_X11
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
 
 //general includes
 #include <string>
 #include <fstream>
+#include <map>
 #include <memory>
 #include <set>
+#include <shared_mutex>
 #include <vector>
 
 #include "Wave.h"
+#include "GLSL_files/packed-wave.h"
+#include "GLSL_files/effect-params.h"
 
 //typedefs
 typedef unsigned char		u_char;
@@ -115,17 +125,78 @@ struct AESDK_OpenGL_EffectCommonData
 	CGLContextObj		mRC;
 	NSOpenGLContext*    mNSOpenGLContext;
 #endif
+#ifdef AE_OS_LINUX
+	EGLDisplay	mDisplay;
+	EGLContext	mContext;
+#endif
 };
 
-struct Vertex {
-	gl::GLfloat pos[4];
-	gl::GLfloat color[4];
-	gl::GLfloat size;
-	gl::GLfloat padding[3];
+#include "GLSL_files/packed-vertex.h"
+
+// same layout as GL's DrawArraysIndirectCommand
+struct DrawArraysIndirectCommand {
+	gl::GLuint count;
+	gl::GLuint instanceCount;
+	gl::GLuint first;
+	gl::GLuint baseInstance;
 };
 
 typedef std::shared_ptr<AESDK_OpenGL_EffectCommonData> AESDK_OpenGL_EffectCommonDataPtr;
 
+// immutable texture kept by a render context between frames
+struct AESDK_OpenGL_PooledTexture {
+	gl::GLuint texture;
+	gl::GLenum internalFormat;
+	gl::GLsizei width;
+	gl::GLsizei height;
+	size_t bytes;
+	bool inUse;
+	u_long lastUsedFrame;
+};
+
+// a program whose compiles and link have been issued but not checked
+struct AESDK_OpenGL_PendingProgram {
+	AESDK_OpenGL_PendingProgram() : program(0), numShaders(0) {}
+
+	gl::GLuint program;
+	gl::GLuint shaders[3];	// none when the program came from the binary cache
+	int numShaders;
+	std::string binaryPath;
+};
+
+/*
+// Programs linked once, in a context sharing the root's objects, and used by every render context
+*/
+
+struct AESDK_OpenGL_EffectPrograms
+{
+	AESDK_OpenGL_EffectPrograms();
+
+	// compute-particles.glsl built for each case of the frame's waves; colorizing only
+	// changes anything when there are waves to colorize
+	enum { kComputeNoWaves = 0, kComputeWaves, kComputeColorizedWaves, kNumComputeVariants };
+	gl::GLuint computeShaderPrograms[kNumComputeVariants];
+	gl::GLuint visualShaderProgram;
+	gl::GLuint hiZShaderProgram;
+	gl::GLuint occlusionShaderProgram;
+	gl::GLuint sortShaderProgram;
+	gl::GLuint microRasterShaderProgram;
+	gl::GLuint microResolveShaderProgram;
+	gl::GLuint spriteShaderProgram;
+
+	// nearest micro block and its depth per pixel are packed into 64 bits when the context
+	// has 64-bit atomics to write them in one pass
+	bool mPackedVisibility;
+
+	// uniform buffer bindings of the blocks in effect-params.h, the same in every program
+	enum { kEffectParamsBinding = 0, kDispatchParamsBinding };
+};
+
+typedef std::shared_ptr<AESDK_OpenGL_EffectPrograms> AESDK_OpenGL_EffectProgramsPtr;
+
+#define AESDK_OpenGL_TEXTURE_POOL_BUDGET	((size_t)512 << 20)
+#define AESDK_OpenGL_DYNAMIC_SLOT_MIN		((gl::GLsizeiptr)64 << 10)
+
 /*
 // Per render/thread supporting OpenGL variables
 */
@@ -136,21 +207,82 @@ struct AESDK_OpenGL_EffectRenderData : public AESDK_OpenGL_EffectCommonData
 	virtual ~AESDK_OpenGL_EffectRenderData();
 
 	gl::GLuint mFrameBufferSu;
-	gl::GLuint mDepthRenderBufferSu;
+	gl::GLuint mDepthTextureSu;	// sampled to build the Hi-Z pyramid
 
 	u_int16 mRenderBufferWidthSu;
 	u_int16 mRenderBufferHeightSu;
 	u_long mNumBlocks;
+	u_long mBlockCapacity;	// blocks the vertex and block list buffers have room for
 	u_long mNumWaves;
 
-	gl::GLuint computeShaderProgram;
-	gl::GLuint visualShaderProgram;
+	// shared with the root context, which owns them
+	AESDK_OpenGL_EffectProgramsPtr mPrograms;
 
 	gl::GLuint mOutputFrameTexture; //pbo texture
 
 	gl::GLuint vao;
 	gl::GLuint vertBuffer;
-	gl::GLuint waveBuffer;
+
+	// indices of the blocks that survived culling, and the indirect draws sized by them, one
+	// command per render path and list. The compute pass fills kDrawList, and with occlusion
+	// culling on leaves its far blocks in kOcclusionCandidateList; cull-occluded.glsl then
+	// moves the ones the Hi-Z pyramid cannot rule out to kOcclusionSurvivorList. With the
+	// compute rasterizer on, blocks only a few pixels across go to kMicroBlockList instead,
+	// and the ones below the LOD size to kSpriteList, drawn as point sprites
+	enum { kDrawList = 0, kOcclusionCandidateList, kOcclusionSurvivorList, kMicroBlockList, kSpriteList, kNumBlockLists };
+	enum { kCubeDrawCommand = 0, kPointDrawCommand, kNumDrawCommands };
+	gl::GLuint blockListBuffers[kNumBlockLists];
+	gl::GLuint drawCommandBuffer;
+
+	// a sorted list is written here and then swapped with the one it was sorted from
+	enum { kSortBuckets = 1024 }; // SORT_BUCKETS in sort-blocks.glsl
+	gl::GLuint mSortedBlockBuffer;
+	gl::GLuint mSortBucketBuffer;
+
+	// nearest micro block and its depth per pixel, packed into 64 bits with
+	// AESDK_OpenGL_EffectPrograms::mPackedVisibility
+	gl::GLuint mVisibilityBuffer;
+
+	// max-depth pyramid over the occluders' depth, level 0 at half the render size
+	gl::GLuint mHiZTexture;
+	gl::GLsizei mHiZLevels;
+
+	// persistently mapped unpack buffer the input layers are staged into
+	gl::GLuint mUploadBuffer;
+	void *mUploadBufferP;
+	gl::GLsizeiptr mUploadBufferSize;
+	gl::GLsync mUploadFence;
+
+	// persistently mapped ring the per-frame data (waves, uniforms) is written into, one slot
+	// per frame in flight, fenced by AESDK_OpenGL_EndDynamicFrame. AESDK_OpenGL_AllocDynamic
+	// hands out aligned ranges of the current slot.
+	enum { kDynamicRingSize = 3 };
+	gl::GLuint mDynamicBuffer;
+	char *mDynamicBufferP;
+	gl::GLsizeiptr mDynamicSlotSize;
+	gl::GLsizeiptr mDynamicSlotUsed;
+	gl::GLint mDynamicAlignment;
+	int mDynamicSlot;
+	gl::GLsync mDynamicFences[kDynamicRingSize];
+
+	// the current slot's ranges holding the frame's PackedWaves, bound to SSBO 3, and its
+	// EffectParams, bound to kEffectParamsBinding. Room is left for up to kMaxDispatchParams
+	// DispatchParams, bound to kDispatchParamsBinding one dispatch at a time.
+	enum { kMaxDispatchParams = 24 };
+	gl::GLintptr mWaveOffset;
+	gl::GLintptr mEffectParamsOffset;
+
+	// pixel-pack buffers DownloadTexture cycles through, one fence each
+	enum { kReadbackRingSize = 3 };
+	gl::GLuint mReadbackBuffers[kReadbackRingSize];
+	gl::GLsync mReadbackFences[kReadbackRingSize];
+	gl::GLsizeiptr mReadbackBufferSize;
+
+	// input textures, reused across frames and evicted least recently used first
+	std::vector<AESDK_OpenGL_PooledTexture> mTexturePool;
+	size_t mTexturePoolBytes;
+	size_t mTexturePoolBudget;
+	u_long mTexturePoolFrame;
 };
 
 typedef std::shared_ptr<AESDK_OpenGL_EffectRenderData> AESDK_OpenGL_EffectRenderDataPtr;
@@ -177,13 +309,42 @@ enum {
 // Core functions
 */
 void AESDK_OpenGL_Startup(AESDK_OpenGL_EffectCommonData& inData, const AESDK_OpenGL_EffectCommonData* inRootContext = nullptr);
+// glbinding keeps every GL function's per-context state in a vector that Binding::initialize
+// grows, without a lock, each time a context is set up, while GL calls on other threads read
+// from it. AESDK_OpenGL_Startup holds this exclusively; hold it shared around any other GL work.
+std::shared_timed_mutex& AESDK_OpenGL_GetBindingMutex();
 void AESDK_OpenGL_Shutdown(AESDK_OpenGL_EffectCommonData& inData);
 
-void AESDK_OpenGL_InitResources(AESDK_OpenGL_EffectRenderData& inData, u_short inBufferWidth, u_short inBufferHeight, u_short numBlocksX, u_short numBlocksY, Wave *waves, u_short numWaves, const std::string& resourcePath);
+// with inContext current; any context sharing its objects can use the programs once it returns.
+// shaderPath is a folder to read the GLSL files from, or empty for the ones built into the plug-in
+void AESDK_OpenGL_InitPrograms(AESDK_OpenGL_EffectPrograms& ioPrograms, const AESDK_OpenGL_EffectCommonData& inContext, const std::string& shaderPath, const std::string& programCachePath, bool useGeometryShader);
+void AESDK_OpenGL_ReleasePrograms(AESDK_OpenGL_EffectPrograms& ioPrograms);
+
+// the Hi-Z pyramid only exists while occlusionCulling is on, the visibility buffer while computeRasterizer is
+void AESDK_OpenGL_InitResources(AESDK_OpenGL_EffectRenderData& inData, u_short inBufferWidth, u_short inBufferHeight, u_short numBlocksX, u_short numBlocksY, PackedWave *waves, u_short numWaves, const AESDK_OpenGL_EffectProgramsPtr& programs, bool occlusionCulling, bool computeRasterizer);
 void AESDK_OpenGL_MakeReadyToRender(AESDK_OpenGL_EffectRenderData& inData, gl::GLuint textureHandle);
-gl::GLuint AESDK_OpenGL_InitVisualShader(std::string inVertexShaderFile, std::string inGeometryShaderFile, std::string inFragmentShaderFile);
-gl::GLuint AESDK_OpenGL_InitComputeShader(std::string inComputeShaderFile);
-void AESDK_OpenGL_BindTextureToTarget(gl::GLuint program, gl::GLint inTexture, std::string inTargetName);
+void AESDK_OpenGL_InitReadbackRing(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inBufferSize);
+void AESDK_OpenGL_InitUploadBuffer(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inBufferSize);
+// inFrameBytes and inNumAllocs must cover every AESDK_OpenGL_AllocDynamic of the frame
+void AESDK_OpenGL_BeginDynamicFrame(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inFrameBytes, int inNumAllocs);
+void* AESDK_OpenGL_AllocDynamic(AESDK_OpenGL_EffectRenderData& inData, gl::GLsizeiptr inBytes, gl::GLintptr& outOffset);
+void AESDK_OpenGL_EndDynamicFrame(AESDK_OpenGL_EffectRenderData& inData);
+void AESDK_OpenGL_WaitFence(gl::GLsync& ioFence);
+// RGBA formats come swizzled from AE's ARGB order
+gl::GLuint AESDK_OpenGL_AcquireTexture(AESDK_OpenGL_EffectRenderData& inData, gl::GLenum inInternalFormat, gl::GLsizei inWidth, gl::GLsizei inHeight);
+void AESDK_OpenGL_RecycleTextures(AESDK_OpenGL_EffectRenderData& inData);
+// an empty inGeometryShaderFile builds a vertex + fragment program. Programs are loaded from
+// and saved to inProgramCachePath as driver binaries; an empty path always compiles.
+gl::GLuint AESDK_OpenGL_InitVisualShader(std::string inVertexShaderFile, std::string inGeometryShaderFile, std::string inFragmentShaderFile, const std::string& inProgramCachePath = std::string());
+// inDefines go right after the #version line, to build a variant of the shader
+gl::GLuint AESDK_OpenGL_InitComputeShader(std::string inComputeShaderFile, const std::string& inProgramCachePath = std::string(), const std::string& inDefines = std::string());
+// the same in two halves: Begin only issues the compiles and the link, so with parallel shader
+// compilation the driver can work on several programs while the caller begins the next
+AESDK_OpenGL_PendingProgram AESDK_OpenGL_BeginVisualShader(std::string inVertexShaderFile, std::string inGeometryShaderFile, std::string inFragmentShaderFile, const std::string& inProgramCachePath = std::string());
+AESDK_OpenGL_PendingProgram AESDK_OpenGL_BeginComputeShader(std::string inComputeShaderFile, const std::string& inProgramCachePath = std::string(), const std::string& inDefines = std::string());
+// hands the linked program over and empties ioPending; a program that fails to build is deleted with its shaders before the throw
+gl::GLuint AESDK_OpenGL_FinishProgram(AESDK_OpenGL_PendingProgram& ioPending);
+void AESDK_OpenGL_ReflectProgram(gl::GLuint program);
 
 
 /*
@@ -195,6 +356,8 @@ void AESDK_OpenGL_BindTextureToTarget(gl::GLuint program, gl::GLint inTexture, s
 	#define GetProcAddress(N) wglGetProcAddress((LPCSTR)N)
 #elif defined(AE_OS_MAC)
 	#define GetProcAddress(N) NSGLGetProcAddress(N)
+#elif defined(AE_OS_LINUX)
+	#define GetProcAddress(N) eglGetProcAddress(N)
 #endif
 
 //helper function - error reporting util
@@ -203,6 +366,8 @@ std::string ReportError(AESDK_OpenGL_Err inError);
 std::string CheckFramebufferStatus();
 //helper function - read shader file into the compiler
 unsigned char* ReadShaderFile(std::string inFile);
+//helper function - put defines after a shader's #version line; takes the source and returns a new one
+unsigned char* InsertShaderDefines(unsigned char* inSourceP, const std::string& inDefines);
 
 /*
 //	Error class and macros used to trap errors
@@ -240,6 +405,12 @@ private:
 	HDC   h_DC; /// Device context handle
 	HGLRC h_RC; /// Handle to an OpenGL rendering context
 #endif
+#ifdef AE_OS_LINUX
+	EGLDisplay	e_Display;
+	EGLSurface	e_Draw;
+	EGLSurface	e_Read;
+	EGLContext	e_Context;
+#endif
 
 	SaveRestoreOGLContext(const SaveRestoreOGLContext &);
 	SaveRestoreOGLContext &operator=(const SaveRestoreOGLContext &);
@@ -0,0 +1,426 @@
+/*
+	DepthWavesHarness.cpp
+
+	Headless render harness. Drives DepthWaves through MockHost for a
+	number of frames and reports how long each pipeline stage took
+	(UploadTexture, ComputeParticles, RenderGL, DownloadTexture, ...), and
+	the overdraw from the fragments that passed the depth test.
+
+	Usage: DepthWavesHarness [options]
+		--width N --height N	comp size (1920x1080)
+		--bpc 8|16|32			project bit depth (8)
+		--frames N				measured frames (30)
+		--warmup N				unmeasured frames rendered first (2)
+		--start-frame N			comp frame of the first rendered frame (0)
+		--blocks N				blocks per axis (50), or --blocks-x / --blocks-y
+		--impulses N			emitter impulses, one every 10 frames (3)
+		--shader-dir DIR		read the GLSL files from DIR rather than the built-in copies
+		--dump FILE.ppm			write the last output frame
+		--allow-empty			do not fail when nothing was drawn
+		--occlusion-culling		turn on the Occlusion Culling checkbox
+		--sort-blocks			turn on the Sort Front To Back checkbox
+		--compute-rasterizer	turn on the Compute Rasterizer checkbox
+		--colorize-waves		turn on the Colorize Waves checkbox
+		--draft					render at draft quality
+		--sweep-blocks N,N,...	benchmark: rerun with N x N blocks for each N and
+								report ComputeParticles throughput per grid size
+*/
+
+#include "MockHost.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace DepthWavesHarness;
+
+namespace {
+
+	struct StageStats
+	{
+		StageStats() : calls(0), totalMs(0.0), minMs(1e30), maxMs(0.0) {}
+
+		void Add(double ms)
+		{
+			++calls;
+			totalMs += ms;
+			minMs = std::min(minMs, ms);
+			maxMs = std::max(maxMs, ms);
+		}
+
+		long	calls;
+		double	totalMs;
+		double	minMs;
+		double	maxMs;
+	};
+
+	bool S_recording = false;
+	std::map<std::string, StageStats> S_stages;
+	std::map<std::string, double> S_counters;	// summed over the measured frames
+	std::mutex S_eventsMutex;
+	std::map<std::string, int> S_events;		// over the whole run, from any thread
+
+	struct Options
+	{
+		Options() :
+			frames(30),
+			warmup(2),
+			startFrame(0),
+			blocksX(DepthWaves_NUM_BLOCKS_DEFAULT),
+			blocksY(DepthWaves_NUM_BLOCKS_DEFAULT),
+			impulses(3),
+			minDepth(1500.0),
+			maxDepth(4000.0),
+			allowEmpty(false),
+			occlusionCulling(false),
+			sortBlocks(false),
+			computeRasterizer(false),
+			colorizeWaves(false)
+		{
+		}
+
+		HostConfig	host;
+		A_long		frames;
+		A_long		warmup;
+		A_long		startFrame;
+		A_long		blocksX;
+		A_long		blocksY;
+		A_long		impulses;
+		PF_FpLong	minDepth;
+		PF_FpLong	maxDepth;
+		std::string	dumpPath;
+		bool		allowEmpty;
+		bool		occlusionCulling;
+		bool		sortBlocks;
+		bool		computeRasterizer;
+		bool		colorizeWaves;
+		std::vector<A_long>	sweepBlocks;
+	};
+
+	void Usage()
+	{
+		fprintf(stderr,
+			"usage: DepthWavesHarness [--width N] [--height N] [--bpc 8|16|32] [--frames N] [--warmup N] [--start-frame N]\n"
+			"                         [--blocks N] [--blocks-x N] [--blocks-y N] [--impulses N] [--min-depth D] [--max-depth D]\n"
+			"                         [--shader-dir DIR] [--dump FILE.ppm] [--allow-empty] [--occlusion-culling]\n"
+			"                         [--sort-blocks] [--compute-rasterizer] [--colorize-waves] [--draft]\n"
+			"                         [--sweep-blocks N,N,...]\n");
+	}
+
+	bool ParseOptions(int argc, char **argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "--allow-empty") {
+				opt.allowEmpty = true;
+			}
+			else if (arg == "--occlusion-culling") {
+				opt.occlusionCulling = true;
+			}
+			else if (arg == "--sort-blocks") {
+				opt.sortBlocks = true;
+			}
+			else if (arg == "--compute-rasterizer") {
+				opt.computeRasterizer = true;
+			}
+			else if (arg == "--colorize-waves") {
+				opt.colorizeWaves = true;
+			}
+			else if (arg == "--draft") {
+				opt.host.quality = PF_Quality_LO;
+			}
+			else if (!hasValue) {
+				return false;
+			}
+			else if (arg == "--width")		{ opt.host.width = atoi(argv[++i]); }
+			else if (arg == "--height")		{ opt.host.height = atoi(argv[++i]); }
+			else if (arg == "--frames")		{ opt.frames = atoi(argv[++i]); }
+			else if (arg == "--warmup")		{ opt.warmup = atoi(argv[++i]); }
+			else if (arg == "--start-frame")	{ opt.startFrame = atoi(argv[++i]); }
+			else if (arg == "--blocks")		{ opt.blocksX = opt.blocksY = atoi(argv[++i]); }
+			else if (arg == "--blocks-x")	{ opt.blocksX = atoi(argv[++i]); }
+			else if (arg == "--blocks-y")	{ opt.blocksY = atoi(argv[++i]); }
+			else if (arg == "--impulses")	{ opt.impulses = atoi(argv[++i]); }
+			else if (arg == "--min-depth")	{ opt.minDepth = atof(argv[++i]); }
+			else if (arg == "--max-depth")	{ opt.maxDepth = atof(argv[++i]); }
+			else if (arg == "--dump")		{ opt.dumpPath = argv[++i]; }
+			else if (arg == "--sweep-blocks") {
+				for (const char *p = argv[++i]; *p; ) {
+					opt.sweepBlocks.push_back(atoi(p));
+					while (*p && *p != ',') { ++p; }
+					if (*p == ',') { ++p; }
+				}
+			}
+			else if (arg == "--shader-dir") {
+				// read by the effect at GlobalSetup
+				setenv("DEPTHWAVES_SHADER_DIR", argv[++i], 1);
+			}
+			else if (arg == "--bpc") {
+				int bpc = atoi(argv[++i]);
+				opt.host.format = bpc == 32 ? PF_PixelFormat_ARGB128 : bpc == 16 ? PF_PixelFormat_ARGB64 : PF_PixelFormat_ARGB32;
+			}
+			else {
+				return false;
+			}
+		}
+		return opt.host.width > 0 && opt.host.height > 0 && opt.frames > 0 && opt.warmup >= 0;
+	}
+
+	void SetupScene(MockHost& host, const Options& opt)
+	{
+		const HostConfig& cfg = host.Config();
+
+		host.SetFloatParam(DepthWaves_MIN_DEPTH, opt.minDepth);
+		host.SetFloatParam(DepthWaves_MAX_DEPTH, opt.maxDepth);
+		host.SetFloatParam(DepthWaves_NEAR_BLOCK_SIZE, 6.0);
+		host.SetFloatParam(DepthWaves_FAR_BLOCK_SIZE, 12.0);
+		host.SetFloatParam(DepthWaves_WAVE_BLOCK_SIZE_MULTIPLIER, 2.0);
+		host.SetFloatParam(DepthWaves_WAVE_DISPLACEMENT, 100.0);
+		host.SetFloatParam(DepthWaves_WAVE_COLOR_MIX, 0.5);
+		host.SetFloatParam(DepthWaves_WAVE_VELOCITY, 1000.0);
+		host.SetFloatParam(DepthWaves_WAVE_DECAY, 0.95);
+		host.SetFloatParam(DepthWaves_NUM_BLOCKS_X, opt.blocksX);
+		host.SetFloatParam(DepthWaves_NUM_BLOCKS_Y, opt.blocksY);
+		host.SetCheckboxParam(DepthWaves_OCCLUSION_CULLING, opt.occlusionCulling);
+		host.SetCheckboxParam(DepthWaves_SORT_FRONT_TO_BACK, opt.sortBlocks);
+		host.SetCheckboxParam(DepthWaves_COMPUTE_RASTERIZER, opt.computeRasterizer);
+		host.SetCheckboxParam(DepthWaves_COLORIZE_WAVES, opt.colorizeWaves);
+		host.SetFloatParam(DepthWaves_COLORIZE_WAVES_CYCLE_RADIUS, 500.0);
+		host.SetPoint3DParam(DepthWaves_EMITTER_POSITION, 0.5 * cfg.width, 0.5 * cfg.height, 0.0);
+		host.SetColorParam(DepthWaves_WAVE_COLOR, 255, 64, 0);
+
+		for (A_long i = 0; i < opt.impulses; ++i) {
+			host.AddImpulse(i * 10, i * 10 + 3);
+		}
+	}
+
+	// FNV-1a over the visible pixels, so row padding does not matter
+	unsigned long long Checksum(const PF_EffectWorld& world, size_t pixSize, double& coverage)
+	{
+		unsigned long long hash = 1469598103934665603ULL;
+		long covered = 0;
+
+		for (A_long y = 0; y < world.height; ++y) {
+			const unsigned char *rowP = reinterpret_cast<const unsigned char*>(world.data) + y * world.rowbytes;
+			for (size_t i = 0; i < world.width * pixSize; ++i) {
+				hash = (hash ^ rowP[i]) * 1099511628211ULL;
+			}
+			for (A_long x = 0; x < world.width; ++x) {
+				bool opaque = false;
+				for (size_t i = 0; i < pixSize && !opaque; ++i) {
+					opaque = rowP[x * pixSize + i] != 0;
+				}
+				covered += opaque ? 1 : 0;
+			}
+		}
+		coverage = static_cast<double>(covered) / (static_cast<double>(world.width) * world.height);
+		return hash;
+	}
+
+	bool DumpPPM(const std::string& path, const PF_EffectWorld& world, PF_PixelFormat format)
+	{
+		FILE *fileP = fopen(path.c_str(), "wb");
+		if (!fileP) {
+			return false;
+		}
+		fprintf(fileP, "P6\n%d %d\n255\n", world.width, world.height);
+
+		for (A_long y = 0; y < world.height; ++y) {
+			const char *rowP = reinterpret_cast<const char*>(world.data) + y * world.rowbytes;
+			for (A_long x = 0; x < world.width; ++x) {
+				float r, g, b;
+				if (format == PF_PixelFormat_ARGB128) {
+					const PF_PixelFloat& p = reinterpret_cast<const PF_PixelFloat*>(rowP)[x];
+					r = p.red; g = p.green; b = p.blue;
+				}
+				else if (format == PF_PixelFormat_ARGB64) {
+					const PF_Pixel16& p = reinterpret_cast<const PF_Pixel16*>(rowP)[x];
+					r = p.red / 32768.f; g = p.green / 32768.f; b = p.blue / 32768.f;
+				}
+				else {
+					const PF_Pixel8& p = reinterpret_cast<const PF_Pixel8*>(rowP)[x];
+					r = p.red / 255.f; g = p.green / 255.f; b = p.blue / 255.f;
+				}
+				unsigned char rgb[3] = {
+					static_cast<unsigned char>(std::min(std::max(r, 0.f), 1.f) * 255.f),
+					static_cast<unsigned char>(std::min(std::max(g, 0.f), 1.f) * 255.f),
+					static_cast<unsigned char>(std::min(std::max(b, 0.f), 1.f) * 255.f)
+				};
+				fwrite(rgb, 1, 3, fileP);
+			}
+		}
+		fclose(fileP);
+		return true;
+	}
+
+	void Record(const char *stageName, double ms)
+	{
+		if (S_recording) {
+			S_stages[stageName].Add(ms);
+		}
+	}
+
+	double ElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// warmup frames first, then the measured ones
+	PF_Err RenderFrames(MockHost& host, const Options& opt)
+	{
+		PF_Err err = PF_Err_NONE;
+
+		for (A_long frame = 0; frame < opt.warmup + opt.frames && !err; ++frame) {
+			S_recording = frame >= opt.warmup;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			err = host.PreRender(opt.startFrame + frame);
+			Record("PreRender", ElapsedMs(start));
+
+			if (!err) {
+				start = std::chrono::steady_clock::now();
+				err = host.SmartRender();
+				Record("SmartRender", ElapsedMs(start));
+			}
+			host.DisposePreRenderData();
+
+			if (err) {
+				fprintf(stderr, "frame %d failed (%d) %s\n", opt.startFrame + frame, err, host.ReturnMessage());
+			}
+		}
+		S_recording = false;
+		return err;
+	}
+
+	double MsPerFrame(const char *stageName, A_long frames)
+	{
+		std::map<std::string, StageStats>::const_iterator it = S_stages.find(stageName);
+		return it == S_stages.end() ? 0.0 : it->second.totalMs / frames;
+	}
+
+	PF_Err SweepBlocks(MockHost& host, const Options& opt)
+	{
+		PF_Err err = PF_Err_NONE;
+
+		printf("DepthWaves block sweep: %dx%d, %d impulses, %d frames (+%d warmup) per grid\n\n",
+			opt.host.width, opt.host.height, opt.impulses, opt.frames, opt.warmup);
+		printf("%-12s %10s %18s %14s %16s\n", "grid", "blocks", "ComputeParticles", "Mblocks/s", "SmartRender ms");
+
+		for (size_t i = 0; i < opt.sweepBlocks.size() && !err; ++i) {
+			A_long n = opt.sweepBlocks[i];
+			host.SetFloatParam(DepthWaves_NUM_BLOCKS_X, n);
+			host.SetFloatParam(DepthWaves_NUM_BLOCKS_Y, n);
+
+			S_stages.clear();
+			err = RenderFrames(host, opt);
+			if (!err) {
+				double computeMs = MsPerFrame("ComputeParticles", opt.frames);
+				double blocks = static_cast<double>(n) * n;
+				char grid[32];
+				snprintf(grid, sizeof(grid), "%dx%d", n, n);
+				printf("%-12s %10.0f %15.3f ms %14.2f %16.3f\n",
+					grid, blocks, computeMs, computeMs > 0.0 ? blocks / (computeMs * 1000.0) : 0.0, MsPerFrame("SmartRender", opt.frames));
+			}
+		}
+		return err;
+	}
+
+} // anonymous namespace
+
+void DepthWaves_ReportStage(const char *stageName, double milliseconds)
+{
+	Record(stageName, milliseconds);
+}
+
+void DepthWaves_ReportCounter(const char *counterName, double value)
+{
+	if (S_recording) {
+		S_counters[counterName] += value;
+	}
+}
+
+void DepthWaves_ReportEvent(const char *eventName)
+{
+	std::lock_guard<std::mutex> lock(S_eventsMutex);
+	++S_events[eventName];
+}
+
+int main(int argc, char **argv)
+{
+	Options opt;
+	if (!ParseOptions(argc, argv, opt)) {
+		Usage();
+		return 2;
+	}
+
+	PF_Err err = PF_Err_NONE;
+	MockHost host(opt.host);
+
+	ERR(host.GlobalSetup());
+	ERR(host.ParamsSetup());
+	if (err) {
+		fprintf(stderr, "setup failed (%d) %s\n", err, host.ReturnMessage());
+		return 1;
+	}
+	SetupScene(host, opt);
+
+	if (!opt.sweepBlocks.empty()) {
+		err = SweepBlocks(host, opt);
+		PF_Err setdownErr = host.GlobalSetdown();
+		return err || setdownErr ? 1 : 0;
+	}
+
+	err = RenderFrames(host, opt);
+
+	if (!err) {
+		const PF_EffectWorld& output = host.Output();
+		size_t pixSize = opt.host.format == PF_PixelFormat_ARGB128 ? sizeof(PF_PixelFloat) : opt.host.format == PF_PixelFormat_ARGB64 ? sizeof(PF_Pixel16) : sizeof(PF_Pixel8);
+		int bpc = static_cast<int>(pixSize * 2);
+
+		printf("DepthWaves harness: %dx%d %dbpc, %dx%d blocks, %d impulses, %d frames (+%d warmup)\n\n",
+			opt.host.width, opt.host.height, bpc, opt.blocksX, opt.blocksY, opt.impulses, opt.frames, opt.warmup);
+		printf("%-22s %8s %12s %10s %10s\n", "stage", "calls", "ms/frame", "min ms", "max ms");
+		for (std::map<std::string, StageStats>::const_iterator it = S_stages.begin(); it != S_stages.end(); ++it) {
+			printf("%-22s %8ld %12.3f %10.3f %10.3f\n",
+				it->first.c_str(), it->second.calls, it->second.totalMs / opt.frames, it->second.minMs, it->second.maxMs);
+		}
+
+		double coverage = 0.0;
+		unsigned long long hash = Checksum(output, pixSize, coverage);
+		printf("\noutput checksum 0x%016llx, coverage %.1f%%\n", hash, coverage * 100.0);
+
+		// every fragment past the first on a covered pixel was shaded for nothing
+		double samplesPassed = S_counters["SamplesPassed"] / opt.frames;
+		double coveredPixels = coverage * opt.host.width * opt.host.height;
+		printf("samples passed %.0f/frame, overdraw %.2fx\n", samplesPassed, coveredPixels > 0.0 ? samplesPassed / coveredPixels : 0.0);
+
+		// the programs are all linked by the first frame, so the counts are final here
+		{
+			std::lock_guard<std::mutex> lock(S_eventsMutex);
+			printf("program cache: %d loaded, %d compiled, %d saved\n",
+				S_events["ProgramBinaryLoaded"], S_events["ProgramCompiled"], S_events["ProgramBinarySaved"]);
+		}
+
+		if (!opt.dumpPath.empty() && !DumpPPM(opt.dumpPath, output, opt.host.format)) {
+			fprintf(stderr, "could not write %s\n", opt.dumpPath.c_str());
+		}
+		if (coverage == 0.0 && !opt.allowEmpty) {
+			fprintf(stderr, "nothing was drawn\n");
+			err = PF_Err_INTERNAL_STRUCT_DAMAGED;
+		}
+	}
+
+	PF_Err setdownErr = host.GlobalSetdown();
+	if (!err) {
+		err = setdownErr;
+	}
+	return err ? 1 : 0;
+}
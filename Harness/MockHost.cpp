@@ -0,0 +1,694 @@
+/*
+	MockHost.cpp
+
+	Stand-in After Effects host, see MockHost.h.
+*/
+
+#include "MockHost.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace DepthWavesHarness
+{
+
+namespace {
+
+	/*
+	** Handles
+	*/
+
+	struct HandleBlock
+	{
+		void		*dataP;		// must stay first, a PF_Handle points at it
+		A_u_long	size;
+	};
+
+	PF_Handle HostNewHandle(A_u_long size)
+	{
+		HandleBlock *blockP = reinterpret_cast<HandleBlock*>(malloc(sizeof(HandleBlock)));
+		if (!blockP) {
+			return NULL;
+		}
+		blockP->dataP = malloc(size ? size : 1);
+		blockP->size = size;
+		if (!blockP->dataP) {
+			free(blockP);
+			return NULL;
+		}
+		return reinterpret_cast<PF_Handle>(&blockP->dataP);
+	}
+
+	void *HostLockHandle(PF_Handle handle)
+	{
+		return handle ? *handle : NULL;
+	}
+
+	void HostUnlockHandle(PF_Handle)
+	{
+	}
+
+	void HostDisposeHandle(PF_Handle handle)
+	{
+		if (handle) {
+			HandleBlock *blockP = reinterpret_cast<HandleBlock*>(handle);
+			free(blockP->dataP);
+			free(blockP);
+		}
+	}
+
+	A_u_long HostGetHandleSize(PF_Handle handle)
+	{
+		return handle ? reinterpret_cast<HandleBlock*>(handle)->size : 0;
+	}
+
+	PF_Err HostResizeHandle(A_u_long new_sizeL, PF_Handle *handlePH)
+	{
+		HandleBlock *blockP = reinterpret_cast<HandleBlock*>(*handlePH);
+		void *dataP = realloc(blockP->dataP, new_sizeL ? new_sizeL : 1);
+		if (!dataP) {
+			return PF_Err_OUT_OF_MEMORY;
+		}
+		blockP->dataP = dataP;
+		blockP->size = new_sizeL;
+		return PF_Err_NONE;
+	}
+
+	A_long HostSprintf(A_char *buffer, const A_char *format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		int written = vsnprintf(buffer, PF_MAX_EFFECT_MSG_LEN + 1, format, args);
+		va_end(args);
+		return written;
+	}
+
+	/*
+	** Worlds
+	*/
+
+	// the mock keeps the pixel format of a world in an otherwise unused field
+	PF_PixelFormat WorldFormat(const PF_EffectWorld *worldP)
+	{
+		return static_cast<PF_PixelFormat>(worldP->reserved_long1);
+	}
+
+	size_t PixelSize(PF_PixelFormat format)
+	{
+		switch (format) {
+		case PF_PixelFormat_ARGB128:	return sizeof(PF_PixelFloat);
+		case PF_PixelFormat_ARGB64:		return sizeof(PF_Pixel16);
+		case PF_PixelFormat_ARGB32:		return sizeof(PF_Pixel8);
+		default:						return 0;
+		}
+	}
+
+	PF_Err GetPixelData8(PF_EffectWorld *worldP, PF_Pixel *, PF_Pixel8 **pixPP)
+	{
+		*pixPP = WorldFormat(worldP) == PF_PixelFormat_ARGB32 ? reinterpret_cast<PF_Pixel8*>(worldP->data) : NULL;
+		return *pixPP ? PF_Err_NONE : PF_Err_BAD_CALLBACK_PARAM;
+	}
+
+	PF_Err GetPixelData16(PF_EffectWorld *worldP, PF_Pixel *, PF_Pixel16 **pixPP)
+	{
+		*pixPP = WorldFormat(worldP) == PF_PixelFormat_ARGB64 ? reinterpret_cast<PF_Pixel16*>(worldP->data) : NULL;
+		return *pixPP ? PF_Err_NONE : PF_Err_BAD_CALLBACK_PARAM;
+	}
+
+	PF_Err GetPixelDataFloat(PF_EffectWorld *worldP, PF_Pixel *, PF_PixelFloat **pixPP)
+	{
+		*pixPP = WorldFormat(worldP) == PF_PixelFormat_ARGB128 ? reinterpret_cast<PF_PixelFloat*>(worldP->data) : NULL;
+		return *pixPP ? PF_Err_NONE : PF_Err_BAD_CALLBACK_PARAM;
+	}
+
+	PF_Err NewWorld(PF_ProgPtr, A_long widthL, A_long heightL, A_Boolean clear_pixB, PF_PixelFormat pixel_format, PF_EffectWorld *worldP)
+	{
+		size_t pixSize = PixelSize(pixel_format);
+		if (!pixSize) {
+			return PF_Err_BAD_CALLBACK_PARAM;
+		}
+		memset(worldP, 0, sizeof(*worldP));
+		worldP->width = widthL;
+		worldP->height = heightL;
+		worldP->rowbytes = static_cast<A_long>(widthL * pixSize);
+		worldP->reserved_long1 = pixel_format;
+		worldP->world_flags = PF_WorldFlag_WRITEABLE | (pixel_format != PF_PixelFormat_ARGB32 ? PF_WorldFlag_DEEP : 0);
+		worldP->pix_aspect_ratio.num = worldP->pix_aspect_ratio.den = 1;
+		worldP->data = clear_pixB ? calloc(heightL, worldP->rowbytes) : malloc(static_cast<size_t>(heightL) * worldP->rowbytes);
+		return worldP->data ? PF_Err_NONE : PF_Err_OUT_OF_MEMORY;
+	}
+
+	PF_Err DisposeWorld(PF_ProgPtr, PF_EffectWorld *worldP)
+	{
+		free(worldP->data);
+		worldP->data = NULL;
+		return PF_Err_NONE;
+	}
+
+	PF_Err GetPixelFormat(const PF_EffectWorld *worldP, PF_PixelFormat *pixel_formatP)
+	{
+		*pixel_formatP = WorldFormat(worldP);
+		return PF_Err_NONE;
+	}
+
+	PF_Err IterateFloat(
+		PF_InData		*,
+		A_long			,
+		A_long			,
+		PF_EffectWorld	*src,
+		const PF_Rect	*area,
+		void			*refcon,
+		PF_Err			(*pix_fn)(void *refcon, A_long x, A_long y, PF_PixelFloat *in, PF_PixelFloat *out),
+		PF_EffectWorld	*dst)
+	{
+		PF_Rect full = { 0, 0, src->width < dst->width ? src->width : dst->width, src->height < dst->height ? src->height : dst->height };
+		const PF_Rect& r = area ? *area : full;
+		PF_Err err = PF_Err_NONE;
+
+		for (A_long y = r.top; y < r.bottom && !err; ++y) {
+			PF_PixelFloat *inP = reinterpret_cast<PF_PixelFloat*>(reinterpret_cast<char*>(src->data) + y * src->rowbytes);
+			PF_PixelFloat *outP = reinterpret_cast<PF_PixelFloat*>(reinterpret_cast<char*>(dst->data) + y * dst->rowbytes);
+			for (A_long x = r.left; x < r.right && !err; ++x) {
+				err = pix_fn(refcon, x, y, inP + x, outP + x);
+			}
+		}
+		return err;
+	}
+
+	/*
+	** Suite tables
+	*/
+
+	const PF_HandleSuite1 S_HandleSuite = {
+		HostNewHandle, HostLockHandle, HostUnlockHandle, HostDisposeHandle, HostGetHandleSize, HostResizeHandle
+	};
+
+	const PF_ANSICallbacksSuite1 S_ANSISuite = { HostSprintf };
+
+	const PF_IterateFloatSuite1 S_IterateFloatSuite = { IterateFloat };
+
+	const PF_WorldSuite2 S_WorldSuite = { NewWorld, DisposeWorld, GetPixelFormat };
+
+	A_Err AcquireSuite(const char *name, A_long version, const void **suite);
+	A_Err ReleaseSuite(const char *, A_long) { return A_Err_NONE; }
+
+	SPBasicSuite S_BasicSuite = { AcquireSuite, ReleaseSuite };
+
+	// filled in by MockHost, whose static members are not visible here
+	PF_ParamUtilsSuite3 S_ParamUtilsSuite;
+	PF_PFInterfaceSuite1 S_InterfaceSuite;
+	AEGP_StreamSuite5 S_StreamSuite;
+
+	A_Err AcquireSuite(const char *name, A_long version, const void **suite)
+	{
+		struct { const char *name; A_long version; const void *suite; } table[] = {
+			{ kPFHandleSuite,			kPFHandleSuiteVersion1,			&S_HandleSuite },
+			{ kPFANSISuite,				kPFANSISuiteVersion1,			&S_ANSISuite },
+			{ kPFIterateFloatSuite,		kPFIterateFloatSuiteVersion1,	&S_IterateFloatSuite },
+			{ kPFWorldSuite,			kPFWorldSuiteVersion2,			&S_WorldSuite },
+			{ kPFParamUtilsSuite,		kPFParamUtilsSuiteVersion3,		&S_ParamUtilsSuite },
+			{ kPFInterfaceSuite,		kPFInterfaceSuiteVersion1,		&S_InterfaceSuite },
+			{ kAEGPStreamSuite,			kAEGPStreamSuiteVersion5,		&S_StreamSuite }
+		};
+
+		for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i) {
+			if (strcmp(table[i].name, name) == 0 && table[i].version == version) {
+				*suite = table[i].suite;
+				return A_Err_NONE;
+			}
+		}
+		*suite = NULL;
+		return PF_Err_BAD_CALLBACK_PARAM;
+	}
+
+	/*
+	** Test pattern
+	*/
+
+	template <typename PixelType, typename ChannelType>
+	void StorePixel(PixelType *pixP, float r, float g, float b, float a, float maxValue)
+	{
+		pixP->alpha = static_cast<ChannelType>(a * maxValue);
+		pixP->red = static_cast<ChannelType>(r * maxValue);
+		pixP->green = static_cast<ChannelType>(g * maxValue);
+		pixP->blue = static_cast<ChannelType>(b * maxValue);
+	}
+
+	void StoreWorldPixel(PF_EffectWorld& world, A_long x, A_long y, float r, float g, float b, float a)
+	{
+		char *rowP = reinterpret_cast<char*>(world.data) + y * world.rowbytes;
+		switch (WorldFormat(&world)) {
+		case PF_PixelFormat_ARGB128:
+			StorePixel<PF_PixelFloat, PF_FpShort>(reinterpret_cast<PF_PixelFloat*>(rowP) + x, r, g, b, a, 1.f);
+			break;
+		case PF_PixelFormat_ARGB64:
+			StorePixel<PF_Pixel16, A_u_short>(reinterpret_cast<PF_Pixel16*>(rowP) + x, r, g, b, a, 32768.f);
+			break;
+		case PF_PixelFormat_ARGB32:
+			StorePixel<PF_Pixel8, A_u_char>(reinterpret_cast<PF_Pixel8*>(rowP) + x, r, g, b, a, 255.f);
+			break;
+		}
+	}
+
+} // anonymous namespace
+
+/*
+** HostConfig
+*/
+
+HostConfig::HostConfig() :
+	width(1920),
+	height(1080),
+	rowPaddingPixels(8),
+	format(PF_PixelFormat_ARGB32),
+	timeScale(30),
+	timeStep(1),
+	quality(PF_Quality_HI)
+{
+}
+
+/*
+** MockHost
+*/
+
+MockHost::MockHost(const HostConfig& config) :
+	mConfig(config)
+{
+	S_ParamUtilsSuite.PF_GetKeyframeCount = GetKeyframeCount;
+	S_ParamUtilsSuite.PF_CheckoutKeyframe = CheckoutKeyframe;
+	S_ParamUtilsSuite.PF_CheckinKeyframe = CheckinKeyframe;
+	S_InterfaceSuite.AEGP_GetEffectCamera = GetEffectCamera;
+	S_InterfaceSuite.AEGP_GetEffectCameraMatrix = GetEffectCameraMatrix;
+	S_InterfaceSuite.AEGP_ConvertEffectToCompTime = [](PF_ProgPtr, A_long what_timeL, A_u_long time_scaleLu, A_Time *comp_timePT) -> A_Err {
+		comp_timePT->value = what_timeL;
+		comp_timePT->scale = time_scaleLu;
+		return A_Err_NONE;
+	};
+	S_StreamSuite.AEGP_GetLayerStreamValue = GetLayerStreamValue;
+
+	AEFX_CLR_STRUCT(mUtils);
+	mUtils.host_new_handle = HostNewHandle;
+	mUtils.host_lock_handle = HostLockHandle;
+	mUtils.host_unlock_handle = HostUnlockHandle;
+	mUtils.host_dispose_handle = HostDisposeHandle;
+	mUtils.get_platform_data = GetPlatformData;
+	mUtils.get_pixel_data8 = GetPixelData8;
+	mUtils.get_pixel_data16 = GetPixelData16;
+	mUtils.get_pixel_data_float = GetPixelDataFloat;
+	mUtils.ansi.sprintf = HostSprintf;
+
+	AEFX_CLR_STRUCT(mInData);
+	mInData.inter.checkout_param = CheckoutParam;
+	mInData.inter.checkin_param = CheckinParam;
+	mInData.inter.add_param = AddParam;
+	mInData.inter.abort = Abort;
+	mInData.inter.progress = Progress;
+	mInData.utils = &mUtils;
+	mInData.effect_ref = this;
+	mInData.quality = mConfig.quality;
+	mInData.time_step = mConfig.timeStep;
+	mInData.local_time_step = mConfig.timeStep;
+	mInData.time_scale = mConfig.timeScale;
+	mInData.width = mConfig.width;
+	mInData.height = mConfig.height;
+	mInData.downsample_x.num = mInData.downsample_x.den = 1;
+	mInData.downsample_y.num = mInData.downsample_y.den = 1;
+	mInData.pixel_aspect_ratio.num = mInData.pixel_aspect_ratio.den = 1;
+	mInData.pica_basicP = &S_BasicSuite;
+
+	AEFX_CLR_STRUCT(mOutData);
+
+	// the effect's own input layer is always parameter zero
+	PF_ParamDef inputDef;
+	AEFX_CLR_STRUCT(inputDef);
+	inputDef.param_type = PF_Param_LAYER;
+	mParams.push_back(inputDef);
+
+	// default AE comp camera: 50mm equivalent, looking down +z at the comp centre
+	mCamera.zoom = mConfig.width * 1.3889;
+	mCamera.position.x = 0.5 * mConfig.width;
+	mCamera.position.y = 0.5 * mConfig.height;
+	mCamera.position.z = -mCamera.zoom;
+	mCamera.orientation.x = mCamera.orientation.y = mCamera.orientation.z = 0.0;
+	mCamera.rotation.x = mCamera.rotation.y = mCamera.rotation.z = 0.0;
+
+	AllocateWorld(mInputWorld);
+	AllocateWorld(mDepthWorld);
+	AllocateWorld(mOutputWorld);
+	FillColorWorld(mInputWorld);
+	FillDepthWorld(mDepthWorld);
+
+	AEFX_CLR_STRUCT(mPreRenderInput);
+	mPreRenderInput.output_request.rect.right = mConfig.width;
+	mPreRenderInput.output_request.rect.bottom = mConfig.height;
+	mPreRenderInput.output_request.channel_mask = PF_ChannelMask_ARGB;
+	mPreRenderInput.bitdepth = static_cast<short>(PixelSize(mConfig.format) * 2);
+	AEFX_CLR_STRUCT(mPreRenderOutput);
+	mPreRenderCallbacks.checkout_layer = CheckoutLayer;
+	mPreRenderCallbacks.GuidMixInPtr = GuidMixIn;
+
+	AEFX_CLR_STRUCT(mSmartRenderInput);
+	mSmartRenderInput.output_request = mPreRenderInput.output_request;
+	mSmartRenderInput.bitdepth = mPreRenderInput.bitdepth;
+	mSmartRenderCallbacks.checkout_layer_pixels = CheckoutLayerPixels;
+	mSmartRenderCallbacks.checkin_layer_pixels = CheckinLayerPixels;
+	mSmartRenderCallbacks.checkout_output = CheckoutOutput;
+}
+
+MockHost::~MockHost()
+{
+	DisposePreRenderData();
+	FreeWorld(mInputWorld);
+	FreeWorld(mDepthWorld);
+	FreeWorld(mOutputWorld);
+}
+
+PF_Err MockHost::Dispatch(PF_Cmd cmd, void *extra)
+{
+	mOutData.return_msg[0] = 0;
+	PF_Err err = EffectMain(cmd, &mInData, &mOutData, NULL, &mOutputWorld, extra);
+	mInData.sequence_data = mOutData.sequence_data;
+	return err;
+}
+
+PF_Err MockHost::GlobalSetup()
+{
+	return Dispatch(PF_Cmd_GLOBAL_SETUP, NULL);
+}
+
+PF_Err MockHost::ParamsSetup()
+{
+	PF_Err err = Dispatch(PF_Cmd_PARAMS_SETUP, NULL);
+	mInData.num_params = mOutData.num_params;
+	if (!err && mOutData.num_params != static_cast<A_long>(mParams.size())) {
+		err = PF_Err_INTERNAL_STRUCT_DAMAGED;
+	}
+	return err;
+}
+
+PF_Err MockHost::GlobalSetdown()
+{
+	return Dispatch(PF_Cmd_GLOBAL_SETDOWN, NULL);
+}
+
+PF_Err MockHost::PreRender(A_long frame)
+{
+	DisposePreRenderData();
+
+	mInData.current_time = frame * mConfig.timeStep;
+	mInData.total_time = mInData.current_time + mConfig.timeStep;
+
+	PF_PreRenderExtra extra;
+	extra.input = &mPreRenderInput;
+	extra.output = &mPreRenderOutput;
+	extra.cb = &mPreRenderCallbacks;
+
+	return Dispatch(PF_Cmd_SMART_PRE_RENDER, &extra);
+}
+
+PF_Err MockHost::SmartRender()
+{
+	mSmartRenderInput.pre_render_data = mPreRenderOutput.pre_render_data;
+
+	PF_SmartRenderExtra extra;
+	extra.input = &mSmartRenderInput;
+	extra.cb = &mSmartRenderCallbacks;
+
+	return Dispatch(PF_Cmd_SMART_RENDER, &extra);
+}
+
+void MockHost::DisposePreRenderData()
+{
+	if (mPreRenderOutput.pre_render_data && mPreRenderOutput.delete_pre_render_data_func) {
+		mPreRenderOutput.delete_pre_render_data_func(mPreRenderOutput.pre_render_data);
+	}
+	AEFX_CLR_STRUCT(mPreRenderOutput);
+	mSmartRenderInput.pre_render_data = NULL;
+}
+
+void MockHost::SetFloatParam(PF_ParamIndex index, PF_FpLong value)
+{
+	mParams.at(index).u.fs_d.value = value;
+}
+
+void MockHost::SetCheckboxParam(PF_ParamIndex index, bool value)
+{
+	mParams.at(index).u.bd.value = value;
+}
+
+void MockHost::SetPoint3DParam(PF_ParamIndex index, PF_FpLong x, PF_FpLong y, PF_FpLong z)
+{
+	mParams.at(index).u.point3d_d.x_value = x;
+	mParams.at(index).u.point3d_d.y_value = y;
+	mParams.at(index).u.point3d_d.z_value = z;
+}
+
+void MockHost::SetColorParam(PF_ParamIndex index, A_u_char red, A_u_char green, A_u_char blue)
+{
+	mParams.at(index).u.cd.value.red = red;
+	mParams.at(index).u.cd.value.green = green;
+	mParams.at(index).u.cd.value.blue = blue;
+	mParams.at(index).u.cd.value.alpha = 255;
+}
+
+void MockHost::AddImpulse(A_long startFrame, A_long endFrame)
+{
+	mImpulseKeys.push_back(std::make_pair(startFrame * mConfig.timeStep, true));
+	mImpulseKeys.push_back(std::make_pair(endFrame * mConfig.timeStep, false));
+}
+
+void MockHost::AllocateWorld(PF_EffectWorld& world)
+{
+	size_t pixSize = PixelSize(mConfig.format);
+
+	memset(&world, 0, sizeof(world));
+	world.width = mConfig.width;
+	world.height = mConfig.height;
+	world.rowbytes = static_cast<A_long>((mConfig.width + mConfig.rowPaddingPixels) * pixSize);
+	world.reserved_long1 = mConfig.format;
+	world.world_flags = PF_WorldFlag_WRITEABLE | (mConfig.format != PF_PixelFormat_ARGB32 ? PF_WorldFlag_DEEP : 0);
+	world.pix_aspect_ratio.num = world.pix_aspect_ratio.den = 1;
+	world.data = calloc(mConfig.height, world.rowbytes);
+	if (!world.data) {
+		throw PF_Err(PF_Err_OUT_OF_MEMORY);
+	}
+}
+
+void MockHost::FreeWorld(PF_EffectWorld& world)
+{
+	free(world.data);
+	world.data = NULL;
+}
+
+void MockHost::FillColorWorld(PF_EffectWorld& world)
+{
+	for (A_long y = 0; y < world.height; ++y) {
+		for (A_long x = 0; x < world.width; ++x) {
+			float u = (x + 0.5f) / world.width;
+			float v = (y + 0.5f) / world.height;
+			float checker = ((x / 64 + y / 64) & 1) ? 1.f : 0.25f;
+			StoreWorldPixel(world, x, y, u, v, checker, 1.f);
+		}
+	}
+}
+
+void MockHost::FillDepthWorld(PF_EffectWorld& world)
+{
+	// a dome: near in the middle of the frame, far at the corners
+	for (A_long y = 0; y < world.height; ++y) {
+		for (A_long x = 0; x < world.width; ++x) {
+			float u = (x + 0.5f) / world.width - 0.5f;
+			float v = (y + 0.5f) / world.height - 0.5f;
+			float d = 1.f - sqrtf(2.f * (u * u + v * v));
+			d = d < 0.f ? 0.f : d;
+			StoreWorldPixel(world, x, y, d, d, d, 1.f);
+		}
+	}
+}
+
+MockHost *MockHost::FromRef(PF_ProgPtr effect_ref)
+{
+	return reinterpret_cast<MockHost*>(effect_ref);
+}
+
+PF_Err MockHost::CheckoutParam(PF_ProgPtr effect_ref, PF_ParamIndex index, A_long what_time, A_long, A_u_long, PF_ParamDef *param)
+{
+	MockHost *hostP = FromRef(effect_ref);
+	if (index < 0 || index >= static_cast<PF_ParamIndex>(hostP->mParams.size())) {
+		return PF_Err_INVALID_INDEX;
+	}
+	*param = hostP->mParams[index];
+
+	// checkboxes hold between keyframes
+	if (index == DepthWaves_EMITTER_IMPULSE) {
+		for (size_t i = 0; i < hostP->mImpulseKeys.size() && hostP->mImpulseKeys[i].first <= what_time; ++i) {
+			param->u.bd.value = hostP->mImpulseKeys[i].second;
+		}
+	}
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckinParam(PF_ProgPtr, PF_ParamDef *)
+{
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::AddParam(PF_ProgPtr effect_ref, PF_ParamIndex index, PF_ParamDefPtr def)
+{
+	MockHost *hostP = FromRef(effect_ref);
+	if (index != -1) {
+		return PF_Err_INVALID_INDEX;
+	}
+	hostP->mParams.push_back(*def);
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::Abort(PF_ProgPtr)
+{
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::Progress(PF_ProgPtr, A_long, A_long)
+{
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::GetPlatformData(PF_ProgPtr, A_long which, void *data)
+{
+	if (which != PF_PlatData_EXE_FILE_PATH_W) {
+		return PF_Err_BAD_CALLBACK_PARAM;
+	}
+
+	// a stand-in; the effect carries its shaders, so no folder around it is read
+	std::string exePath = "DepthWaves.so";
+	A_UTF16Char *outP = reinterpret_cast<A_UTF16Char*>(data);
+	for (size_t i = 0; i < exePath.size(); ++i) {
+		outP[i] = static_cast<A_UTF16Char>(static_cast<unsigned char>(exePath[i]));
+	}
+	outP[exePath.size()] = 0;
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckoutLayer(PF_ProgPtr effect_ref, PF_ParamIndex index, A_long, const PF_RenderRequest *req, A_long, A_long, A_u_long, PF_CheckoutResult *checkout_result)
+{
+	MockHost *hostP = FromRef(effect_ref);
+	if (index != DepthWaves_INPUT && index != DepthWaves_DEPTHMAP_LAYER) {
+		return PF_Err_INVALID_INDEX;
+	}
+
+	AEFX_CLR_STRUCT(*checkout_result);
+	checkout_result->result_rect = req->rect;
+	checkout_result->max_result_rect.right = hostP->mConfig.width;
+	checkout_result->max_result_rect.bottom = hostP->mConfig.height;
+	checkout_result->par.num = checkout_result->par.den = 1;
+	checkout_result->ref_width = hostP->mConfig.width;
+	checkout_result->ref_height = hostP->mConfig.height;
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::GuidMixIn(PF_ProgPtr, A_u_long, const void *)
+{
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckoutLayerPixels(PF_ProgPtr effect_ref, A_long checkout_idL, PF_EffectWorld **pixels)
+{
+	MockHost *hostP = FromRef(effect_ref);
+	switch (checkout_idL) {
+	case DepthWaves_INPUT:			*pixels = &hostP->mInputWorld; break;
+	case DepthWaves_DEPTHMAP_LAYER:	*pixels = &hostP->mDepthWorld; break;
+	default:						return PF_Err_INVALID_INDEX;
+	}
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckinLayerPixels(PF_ProgPtr, A_long)
+{
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckoutOutput(PF_ProgPtr effect_ref, PF_EffectWorld **output)
+{
+	*output = &FromRef(effect_ref)->mOutputWorld;
+	return PF_Err_NONE;
+}
+
+A_Err MockHost::GetEffectCamera(PF_ProgPtr effect_ref, const A_Time *, AEGP_LayerH *camera_layerPH)
+{
+	// the camera "layer" is the host itself
+	*camera_layerPH = reinterpret_cast<AEGP_LayerH>(effect_ref);
+	return A_Err_NONE;
+}
+
+A_Err MockHost::GetEffectCameraMatrix(PF_ProgPtr effect_ref, const A_Time *, A_Matrix4 *camera_matrixP, A_FpLong *dst_to_planePF, A_short *plane_widthPL, A_short *plane_heightPL)
+{
+	MockHost *hostP = FromRef(effect_ref);
+
+	memset(camera_matrixP, 0, sizeof(*camera_matrixP));
+	for (int i = 0; i < 4; ++i) {
+		camera_matrixP->mat[i][i] = 1.0;
+	}
+	camera_matrixP->mat[3][0] = hostP->mCamera.position.x;
+	camera_matrixP->mat[3][1] = hostP->mCamera.position.y;
+	camera_matrixP->mat[3][2] = hostP->mCamera.position.z;
+
+	*dst_to_planePF = hostP->mCamera.zoom;
+	*plane_widthPL = static_cast<A_short>(hostP->mConfig.width);
+	*plane_heightPL = static_cast<A_short>(hostP->mConfig.height);
+	return A_Err_NONE;
+}
+
+A_Err MockHost::GetLayerStreamValue(AEGP_LayerH layerH, AEGP_LayerStream which_stream, AEGP_LTimeMode, const A_Time *, A_Boolean, AEGP_StreamVal2 *stream_valP, AEGP_StreamType *)
+{
+	MockHost *hostP = reinterpret_cast<MockHost*>(layerH);
+	memset(stream_valP, 0, sizeof(*stream_valP));
+
+	switch (which_stream) {
+	case AEGP_LayerStream_POSITION:		stream_valP->three_d = hostP->mCamera.position; break;
+	case AEGP_LayerStream_ORIENTATION:	stream_valP->three_d = hostP->mCamera.orientation; break;
+	case AEGP_LayerStream_ROTATE_X:		stream_valP->one_d = hostP->mCamera.rotation.x; break;
+	case AEGP_LayerStream_ROTATE_Y:		stream_valP->one_d = hostP->mCamera.rotation.y; break;
+	case AEGP_LayerStream_ROTATE_Z:		stream_valP->one_d = hostP->mCamera.rotation.z; break;
+	case AEGP_LayerStream_ZOOM:			stream_valP->one_d = hostP->mCamera.zoom; break;
+	default:							return PF_Err_BAD_CALLBACK_PARAM;
+	}
+	return A_Err_NONE;
+}
+
+PF_Err MockHost::GetKeyframeCount(PF_ProgPtr effect_ref, PF_ParamIndex param_index, PF_KeyIndex *key_countP)
+{
+	MockHost *hostP = FromRef(effect_ref);
+	*key_countP = param_index == DepthWaves_EMITTER_IMPULSE ? static_cast<PF_KeyIndex>(hostP->mImpulseKeys.size()) : 0;
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckoutKeyframe(PF_ProgPtr effect_ref, PF_ParamIndex param_index, PF_KeyIndex key_index, A_long *key_timeP0, A_u_long *key_timescaleP0, PF_ParamDef *paramP0)
+{
+	MockHost *hostP = FromRef(effect_ref);
+	if (param_index != DepthWaves_EMITTER_IMPULSE || key_index < 0 || key_index >= static_cast<PF_KeyIndex>(hostP->mImpulseKeys.size())) {
+		return PF_Err_INVALID_INDEX;
+	}
+
+	const std::pair<A_long, bool>& key = hostP->mImpulseKeys[key_index];
+	if (key_timeP0) {
+		*key_timeP0 = key.first;
+	}
+	if (key_timescaleP0) {
+		*key_timescaleP0 = hostP->mConfig.timeScale;
+	}
+	if (paramP0) {
+		*paramP0 = hostP->mParams[param_index];
+		paramP0->u.bd.value = key.second;
+	}
+	return PF_Err_NONE;
+}
+
+PF_Err MockHost::CheckinKeyframe(PF_ProgPtr, PF_ParamDef *)
+{
+	return PF_Err_NONE;
+}
+
+} // namespace DepthWavesHarness
@@ -0,0 +1,137 @@
+/*
+	MockHost.h
+
+	A stand-in After Effects host for driving DepthWaves headless.
+
+	It owns fake PF_InData/PF_OutData, the parameter and keyframe tables,
+	the SmartFX callbacks, a fixed comp camera and the three layer worlds
+	(colour input, depth map, output), and dispatches commands to
+	EffectMain exactly the way AE does for a SmartFX effect.
+*/
+
+#pragma once
+
+#ifndef MOCK_HOST_H
+#define MOCK_HOST_H
+
+#include "DepthWaves.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace DepthWavesHarness
+{
+
+struct HostConfig
+{
+	HostConfig();
+
+	A_long			width;
+	A_long			height;
+	A_long			rowPaddingPixels;	// extra pixels per row, like AE's padded rowbytes
+	PF_PixelFormat	format;
+	A_u_long		timeScale;
+	A_long			timeStep;
+	PF_Quality		quality;
+};
+
+class MockHost
+{
+public:
+	explicit MockHost(const HostConfig& config);
+	~MockHost();
+
+	// effect commands
+	PF_Err GlobalSetup();
+	PF_Err ParamsSetup();
+	PF_Err GlobalSetdown();
+
+	// one SmartFX frame: PF_Cmd_SMART_PRE_RENDER followed by PF_Cmd_SMART_RENDER
+	PF_Err PreRender(A_long frame);
+	PF_Err SmartRender();
+	void DisposePreRenderData();
+
+	// parameter values, applied after ParamsSetup
+	void SetFloatParam(PF_ParamIndex index, PF_FpLong value);
+	void SetCheckboxParam(PF_ParamIndex index, bool value);
+	void SetPoint3DParam(PF_ParamIndex index, PF_FpLong x, PF_FpLong y, PF_FpLong z);
+	void SetColorParam(PF_ParamIndex index, A_u_char red, A_u_char green, A_u_char blue);
+
+	// emitter keyframes, in frames
+	void AddImpulse(A_long startFrame, A_long endFrame);
+
+	const PF_EffectWorld& Output() const { return mOutputWorld; }
+	const HostConfig& Config() const { return mConfig; }
+	const char *ReturnMessage() const { return mOutData.return_msg; }
+
+private:
+	struct CameraState
+	{
+		A_FloatPoint3	position;
+		A_FloatPoint3	orientation;
+		A_FloatPoint3	rotation;
+		A_FpLong		zoom;
+	};
+
+	PF_Err Dispatch(PF_Cmd cmd, void *extra);
+
+	void AllocateWorld(PF_EffectWorld& world);
+	void FreeWorld(PF_EffectWorld& world);
+	void FillColorWorld(PF_EffectWorld& world);
+	void FillDepthWorld(PF_EffectWorld& world);
+
+	static MockHost *FromRef(PF_ProgPtr effect_ref);
+
+	// PF_InteractCallbacks
+	static PF_Err CheckoutParam(PF_ProgPtr effect_ref, PF_ParamIndex index, A_long what_time, A_long time_step, A_u_long time_scale, PF_ParamDef *param);
+	static PF_Err CheckinParam(PF_ProgPtr effect_ref, PF_ParamDef *param);
+	static PF_Err AddParam(PF_ProgPtr effect_ref, PF_ParamIndex index, PF_ParamDefPtr def);
+	static PF_Err Abort(PF_ProgPtr effect_ref);
+	static PF_Err Progress(PF_ProgPtr effect_ref, A_long current, A_long total);
+
+	// PF_UtilCallbacks
+	static PF_Err GetPlatformData(PF_ProgPtr effect_ref, A_long which, void *data);
+
+	// SmartFX callbacks
+	static PF_Err CheckoutLayer(PF_ProgPtr effect_ref, PF_ParamIndex index, A_long checkout_idL, const PF_RenderRequest *req, A_long what_time, A_long time_step, A_u_long time_scale, PF_CheckoutResult *checkout_result);
+	static PF_Err GuidMixIn(PF_ProgPtr effect_ref, A_u_long buf_sizeLu, const void *buf);
+	static PF_Err CheckoutLayerPixels(PF_ProgPtr effect_ref, A_long checkout_idL, PF_EffectWorld **pixels);
+	static PF_Err CheckinLayerPixels(PF_ProgPtr effect_ref, A_long checkout_idL);
+	static PF_Err CheckoutOutput(PF_ProgPtr effect_ref, PF_EffectWorld **output);
+
+	// AEGP camera access
+	static A_Err GetEffectCamera(PF_ProgPtr effect_ref, const A_Time *comp_timePT, AEGP_LayerH *camera_layerPH);
+	static A_Err GetEffectCameraMatrix(PF_ProgPtr effect_ref, const A_Time *comp_timePT, A_Matrix4 *camera_matrixP, A_FpLong *dst_to_planePF, A_short *plane_widthPL, A_short *plane_heightPL);
+	static A_Err GetLayerStreamValue(AEGP_LayerH layerH, AEGP_LayerStream which_stream, AEGP_LTimeMode time_mode, const A_Time *timePT, A_Boolean pre_expressionB, AEGP_StreamVal2 *stream_valP, AEGP_StreamType *stream_typeP0);
+
+	// keyframes
+	static PF_Err GetKeyframeCount(PF_ProgPtr effect_ref, PF_ParamIndex param_index, PF_KeyIndex *key_countP);
+	static PF_Err CheckoutKeyframe(PF_ProgPtr effect_ref, PF_ParamIndex param_index, PF_KeyIndex key_index, A_long *key_timeP0, A_u_long *key_timescaleP0, PF_ParamDef *paramP0);
+	static PF_Err CheckinKeyframe(PF_ProgPtr effect_ref, PF_ParamDef *paramP);
+
+	HostConfig					mConfig;
+
+	PF_InData					mInData;
+	PF_OutData					mOutData;
+	PF_UtilCallbacks			mUtils;
+
+	std::vector<PF_ParamDef>	mParams;
+	std::vector<std::pair<A_long, bool> >	mImpulseKeys;	// (time, emitting)
+
+	CameraState					mCamera;
+
+	PF_EffectWorld				mInputWorld;
+	PF_EffectWorld				mDepthWorld;
+	PF_EffectWorld				mOutputWorld;
+
+	PF_PreRenderInput			mPreRenderInput;
+	PF_PreRenderOutput			mPreRenderOutput;
+	PF_PreRenderCallbacks		mPreRenderCallbacks;
+	PF_SmartRenderInput			mSmartRenderInput;
+	PF_SmartRenderCallbacks		mSmartRenderCallbacks;
+};
+
+} // namespace DepthWavesHarness
+
+#endif // MOCK_HOST_H
@@ -0,0 +1,42 @@
+/*
+	A.h
+
+	Harness stand-in for the AE SDK basic types. Only what DepthWaves uses.
+*/
+
+#pragma once
+
+#ifndef MOCK_A_H
+#define MOCK_A_H
+
+#include <stdint.h>
+
+typedef int32_t			A_long;
+typedef uint32_t		A_u_long;
+typedef int16_t			A_short;
+typedef uint16_t		A_u_short;
+typedef char			A_char;
+typedef uint8_t			A_u_char;
+typedef uint8_t			A_Boolean;
+typedef double			A_FpLong;
+typedef float			A_FpShort;
+typedef A_long			A_Err;
+typedef uint16_t		A_UTF16Char;
+typedef int64_t			A_intptr_t;
+
+typedef struct {
+	A_long		value;
+	A_u_long	scale;
+} A_Time;
+
+typedef struct {
+	A_FpLong	x, y, z;
+} A_FloatPoint3;
+
+typedef struct {
+	A_FpLong	mat[4][4];
+} A_Matrix4;
+
+#define A_Err_NONE	0
+
+#endif // MOCK_A_H
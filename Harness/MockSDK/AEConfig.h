@@ -0,0 +1,16 @@
+/*
+	AEConfig.h
+
+	Harness stand-in for the AE SDK configuration header. The harness only
+	runs headless on Linux, so the effect sees neither AE_OS_WIN nor AE_OS_MAC.
+*/
+
+#pragma once
+
+#ifndef MOCK_AE_CONFIG_H
+#define MOCK_AE_CONFIG_H
+
+#define AE_OS_LINUX
+#define AE_PROC_INTELx64
+
+#endif // MOCK_AE_CONFIG_H
@@ -0,0 +1,14 @@
+/*
+	AEFX_ChannelDepthTpl.h
+
+	Harness stand-in; DepthWaves includes it but uses none of its templates.
+*/
+
+#pragma once
+
+#ifndef MOCK_AEFX_CHANNEL_DEPTH_TPL_H
+#define MOCK_AEFX_CHANNEL_DEPTH_TPL_H
+
+#include "AE_Effect.h"
+
+#endif // MOCK_AEFX_CHANNEL_DEPTH_TPL_H
@@ -0,0 +1,72 @@
+/*
+	AEFX_SuiteHelper.h
+
+	Harness stand-in for the SDK's suite acquire/release helpers.
+*/
+
+#pragma once
+
+#ifndef MOCK_AEFX_SUITE_HELPER_H
+#define MOCK_AEFX_SUITE_HELPER_H
+
+#include "AE_EffectCB.h"
+
+inline PF_Err AEFX_AcquireSuite(
+	PF_InData		*in_data,
+	PF_OutData		*out_data,
+	const char		*name,
+	A_long			version,
+	const char		*error_stringPC0,
+	void			**suite)
+{
+	const void *suiteP = NULL;
+	if (in_data->pica_basicP->AcquireSuite(name, version, &suiteP) != A_Err_NONE || suiteP == NULL) {
+		if (error_stringPC0 && out_data) {
+			out_data->out_flags |= PF_OutFlag_DISPLAY_ERROR_MESSAGE;
+		}
+		return PF_Err_BAD_CALLBACK_PARAM;
+	}
+	*suite = const_cast<void*>(suiteP);
+	return PF_Err_NONE;
+}
+
+inline PF_Err AEFX_ReleaseSuite(
+	PF_InData		*in_data,
+	PF_OutData		*,
+	const char		*name,
+	A_long			version,
+	const char		*)
+{
+	return in_data->pica_basicP->ReleaseSuite(name, version);
+}
+
+template <typename SuiteType>
+class AEFX_SuiteScoper
+{
+public:
+	AEFX_SuiteScoper(PF_InData *in_data, const char *name, A_long version, PF_OutData *out_data = NULL)
+		: i_in_data(in_data), i_name(name), i_version(version), i_suiteP(NULL)
+	{
+		void *suiteP = NULL;
+		if (AEFX_AcquireSuite(in_data, out_data, name, version, NULL, &suiteP) != PF_Err_NONE) {
+			throw PF_Err(PF_Err_BAD_CALLBACK_PARAM);
+		}
+		i_suiteP = reinterpret_cast<const SuiteType*>(suiteP);
+	}
+
+	~AEFX_SuiteScoper()
+	{
+		AEFX_ReleaseSuite(i_in_data, NULL, i_name, i_version, NULL);
+	}
+
+	const SuiteType *operator->() const { return i_suiteP; }
+	const SuiteType *get() const { return i_suiteP; }
+
+private:
+	PF_InData			*i_in_data;
+	const char			*i_name;
+	A_long				i_version;
+	const SuiteType		*i_suiteP;
+};
+
+#endif // MOCK_AEFX_SUITE_HELPER_H
@@ -0,0 +1,44 @@
+/*
+	AEGP_SuiteHandler.h
+
+	Harness stand-in for the SDK's lazy suite acquirer. Suites are fetched
+	from the host's SPBasicSuite on first use, just like the real class.
+*/
+
+#pragma once
+
+#ifndef MOCK_AEGP_SUITE_HANDLER_H
+#define MOCK_AEGP_SUITE_HANDLER_H
+
+#include "AE_EffectCB.h"
+#include "AE_EffectCBSuites.h"
+#include "AE_GeneralPlug.h"
+
+class AEGP_SuiteHandler
+{
+public:
+	explicit AEGP_SuiteHandler(const SPBasicSuite *pica_basicP) : i_pica_basicP(pica_basicP) {}
+
+	const PF_HandleSuite1			*HandleSuite1() const			{ return Acquire<PF_HandleSuite1>(kPFHandleSuite, kPFHandleSuiteVersion1); }
+	const PF_ANSICallbacksSuite1	*ANSICallbacksSuite1() const	{ return Acquire<PF_ANSICallbacksSuite1>(kPFANSISuite, kPFANSISuiteVersion1); }
+	const PF_IterateFloatSuite1		*IterateFloatSuite1() const		{ return Acquire<PF_IterateFloatSuite1>(kPFIterateFloatSuite, kPFIterateFloatSuiteVersion1); }
+	const PF_WorldSuite2			*WorldSuite2() const			{ return Acquire<PF_WorldSuite2>(kPFWorldSuite, kPFWorldSuiteVersion2); }
+	const PF_ParamUtilsSuite3		*ParamUtilsSuite3() const		{ return Acquire<PF_ParamUtilsSuite3>(kPFParamUtilsSuite, kPFParamUtilsSuiteVersion3); }
+	const PF_PFInterfaceSuite1		*PFInterfaceSuite1() const		{ return Acquire<PF_PFInterfaceSuite1>(kPFInterfaceSuite, kPFInterfaceSuiteVersion1); }
+	const AEGP_StreamSuite5			*StreamSuite5() const			{ return Acquire<AEGP_StreamSuite5>(kAEGPStreamSuite, kAEGPStreamSuiteVersion5); }
+
+private:
+	template <typename SuiteType>
+	const SuiteType *Acquire(const char *name, A_long version) const
+	{
+		const void *suiteP = NULL;
+		if (i_pica_basicP->AcquireSuite(name, version, &suiteP) != A_Err_NONE || suiteP == NULL) {
+			throw A_Err(PF_Err_BAD_CALLBACK_PARAM);
+		}
+		return reinterpret_cast<const SuiteType*>(suiteP);
+	}
+
+	const SPBasicSuite *i_pica_basicP;
+};
+
+#endif // MOCK_AEGP_SUITE_HANDLER_H
@@ -0,0 +1,426 @@
+/*
+	AE_Effect.h
+
+	Harness stand-in for the AE SDK effect API. The layouts only mirror the
+	members DepthWaves touches; they are NOT binary compatible with AE.
+*/
+
+#pragma once
+
+#ifndef MOCK_AE_EFFECT_H
+#define MOCK_AE_EFFECT_H
+
+#include "A.h"
+#include "entry.h"
+
+#include <stddef.h>
+
+#define PF_PLUG_IN_VERSION		13
+#define PF_PLUG_IN_SUBVERS		25
+
+#define PF_RAD_PER_DEGREE		0.01745329251994329576923690768489
+#define PF_MAX_EFFECT_MSG_LEN	255
+#define PF_MAX_EFFECT_PARAM_NAME_LEN	31
+
+typedef A_long	PF_Err;
+typedef A_long	PF_Cmd;
+typedef A_long	PF_ParamIndex;
+typedef A_long	PF_KeyIndex;
+typedef A_FpLong	PF_FpLong;
+typedef A_FpShort	PF_FpShort;
+typedef A_long	PF_Fixed;
+typedef void	**PF_Handle;
+typedef void	*PF_ProgPtr;
+
+enum {
+	PF_Err_NONE = 0,
+	PF_Err_OUT_OF_MEMORY = 4,
+	PF_Err_INTERNAL_STRUCT_DAMAGED = 512,
+	PF_Err_INVALID_INDEX,
+	PF_Err_UNRECOGNIZED_PARAM_TYPE,
+	PF_Err_INVALID_CALLBACK,
+	PF_Err_BAD_CALLBACK_PARAM,
+	PF_Interrupt_CANCEL,
+	PF_Err_CANNOT_PARSE_KEYFRAME_TEXT
+};
+
+enum {
+	PF_Cmd_ABOUT = 0,
+	PF_Cmd_GLOBAL_SETUP,
+	PF_Cmd_UNUSED_0,
+	PF_Cmd_GLOBAL_SETDOWN,
+	PF_Cmd_PARAMS_SETUP,
+	PF_Cmd_SEQUENCE_SETUP,
+	PF_Cmd_SEQUENCE_RESETUP,
+	PF_Cmd_SEQUENCE_FLATTEN,
+	PF_Cmd_SEQUENCE_SETDOWN,
+	PF_Cmd_DO_DIALOG,
+	PF_Cmd_FRAME_SETUP,
+	PF_Cmd_RENDER,
+	PF_Cmd_FRAME_SETDOWN,
+	PF_Cmd_SMART_PRE_RENDER = 33,
+	PF_Cmd_SMART_RENDER
+};
+
+enum {
+	PF_Stage_DEVELOP,
+	PF_Stage_ALPHA,
+	PF_Stage_BETA,
+	PF_Stage_RELEASE
+};
+
+#define PF_VERSION(VERS, SUBVERS, BUGVERS, STAGE, BUILD) \
+	((((VERS) & 0x7) << 19) | (((SUBVERS) & 0xF) << 15) | (((BUGVERS) & 0xF) << 11) | (((STAGE) & 0x3) << 9) | ((BUILD) & 0x1FF))
+
+enum {
+	PF_OutFlag_NONE = 0,
+	PF_OutFlag_DISPLAY_ERROR_MESSAGE = 1L << 9,
+	PF_OutFlag_DEEP_COLOR_AWARE = 1L << 25
+};
+
+enum {
+	PF_OutFlag2_NONE = 0,
+	PF_OutFlag2_SUPPORTS_SMART_RENDER = 1L << 10,
+	PF_OutFlag2_FLOAT_COLOR_AWARE = 1L << 12,
+	PF_OutFlag2_I_MIX_GUID_DEPENDENCIES = 1L << 21
+};
+
+
+/* Pixels and worlds */
+
+typedef struct {
+	A_u_char	alpha, red, green, blue;
+} PF_Pixel, PF_Pixel8;
+
+typedef struct {
+	A_u_short	alpha, red, green, blue;
+} PF_Pixel16;
+
+typedef struct {
+	PF_FpShort	alpha, red, green, blue;
+} PF_PixelFloat, PF_Pixel32;
+
+typedef A_long PF_PixelFormat;
+
+enum {
+	PF_PixelFormat_ARGB32 = 'argb',
+	PF_PixelFormat_ARGB64 = 'ar16',
+	PF_PixelFormat_ARGB128 = 'ar32',
+	PF_PixelFormat_INVALID = 'badf'
+};
+
+typedef A_long PF_Quality;
+
+enum {
+	PF_Quality_DRAWING_AUDIO = -1,
+	PF_Quality_LO = 0,
+	PF_Quality_HI
+};
+
+typedef struct {
+	A_long	left, top, right, bottom;
+} PF_LRect, PF_Rect;
+
+typedef struct {
+	A_long		num;
+	A_u_long	den;
+} PF_RationalScale;
+
+enum {
+	PF_WorldFlag_DEEP = 1L << 0,
+	PF_WorldFlag_WRITEABLE = 1L << 1
+};
+
+typedef struct PF_LayerDef {
+	void		*reserved0;
+	void		*reserved1;
+	A_long		world_flags;
+	void		*data;
+	A_long		rowbytes;
+	A_long		width;
+	A_long		height;
+	PF_Rect		extent_hint;
+	void		*platform_ref;
+	A_long		reserved_long1;
+	void		*reserved_long4;
+	PF_RationalScale	pix_aspect_ratio;
+	void		*reserved_long2;
+	A_long		origin_x;
+	A_long		origin_y;
+	A_long		reserved_long3;
+	A_long		dephault;
+} PF_LayerDef, PF_EffectWorld;
+
+enum {
+	PF_LayerDefault_MYSELF = -1,
+	PF_LayerDefault_NONE = 0
+};
+
+
+/* Parameters */
+
+typedef A_long PF_ParamType;
+
+enum {
+	PF_Param_RESERVED = -1,
+	PF_Param_LAYER = 0,
+	PF_Param_SLIDER,
+	PF_Param_FIX_SLIDER,
+	PF_Param_ANGLE,
+	PF_Param_CHECKBOX,
+	PF_Param_COLOR,
+	PF_Param_POINT,
+	PF_Param_POPUP,
+	PF_Param_CUSTOM,
+	PF_Param_NO_DATA,
+	PF_Param_FLOAT_SLIDER,
+	PF_Param_ARBITRARY_DATA,
+	PF_Param_PATH,
+	PF_Param_GROUP_START,
+	PF_Param_GROUP_END,
+	PF_Param_BUTTON,
+	PF_Param_RESERVED2,
+	PF_Param_RESERVED3,
+	PF_Param_POINT_3D
+};
+
+typedef A_long PF_ParamFlags;
+
+enum {
+	PF_ParamFlag_NONE = 0,
+	PF_ParamFlag_RESERVED1 = 1L << 0
+};
+
+typedef A_short PF_ValueDisplayFlags;
+
+enum {
+	PF_ValueDisplayFlag_NONE = 0,
+	PF_ValueDisplayFlag_PERCENT = 1 << 0
+};
+
+enum {
+	PF_Precision_INTEGER,
+	PF_Precision_TENTHS,
+	PF_Precision_HUNDREDTHS,
+	PF_Precision_THOUSANDTHS,
+	PF_Precision_TEN_THOUSANDTHS
+};
+
+typedef struct {
+	PF_FpLong		value;
+	PF_FpShort		valid_min, valid_max;
+	PF_FpShort		slider_min, slider_max;
+	PF_FpShort		dephault;
+	A_short			precision;
+	PF_ValueDisplayFlags	display_flags;
+} PF_FloatSliderDef;
+
+typedef struct {
+	A_long		value;
+	A_long		dephault;
+} PF_CheckBoxDef;
+
+typedef struct {
+	PF_Pixel	value;
+	PF_Pixel	dephault;
+} PF_ColorDef;
+
+typedef struct {
+	PF_FpLong	x_value, y_value, z_value;
+	PF_FpLong	x_dephault, y_dephault, z_dephault;
+} PF_Point3DDef;
+
+typedef union {
+	PF_LayerDef			ld;
+	PF_FloatSliderDef	fs_d;
+	PF_CheckBoxDef		bd;
+	PF_ColorDef			cd;
+	PF_Point3DDef		point3d_d;
+} PF_ParamDefUnion;
+
+typedef struct PF_ParamDef {
+	union {
+		A_long			id;
+		A_long			change_flag;
+	} uu;
+	A_short				ui_flags;
+	A_short				ui_width;
+	A_short				ui_height;
+	PF_ParamType		param_type;
+	A_char				name[PF_MAX_EFFECT_PARAM_NAME_LEN + 1];
+	PF_ParamFlags		flags;
+	A_long				unused;
+	PF_ParamDefUnion	u;
+} PF_ParamDef, *PF_ParamDefPtr, **PF_ParamDefH;
+
+typedef PF_ParamDef *PF_ParamList[];
+
+
+/* Host callbacks */
+
+typedef struct {
+	PF_Err (*checkout_param)(PF_ProgPtr effect_ref, PF_ParamIndex index, A_long what_time, A_long time_step, A_u_long time_scale, PF_ParamDef *param);
+	PF_Err (*checkin_param)(PF_ProgPtr effect_ref, PF_ParamDef *param);
+	PF_Err (*add_param)(PF_ProgPtr effect_ref, PF_ParamIndex index, PF_ParamDefPtr def);
+	PF_Err (*abort)(PF_ProgPtr effect_ref);
+	PF_Err (*progress)(PF_ProgPtr effect_ref, A_long current, A_long total);
+} PF_InteractCallbacks;
+
+struct SPBasicSuite;
+struct _PF_UtilCallbacks;
+
+typedef struct PF_InData {
+	PF_InteractCallbacks	inter;
+	struct _PF_UtilCallbacks	*utils;
+	PF_ProgPtr				effect_ref;
+	PF_Quality				quality;
+	A_long					version;
+	A_long					serial_num;
+	A_long					appl_id;
+	A_long					num_params;
+	A_long					reserved;
+	A_long					what_cpu;
+	A_long					what_fpu;
+	A_long					current_time;
+	A_long					time_step;
+	A_long					total_time;
+	A_long					local_time_step;
+	A_u_long				time_scale;
+	A_long					field;
+	PF_Fixed				shutter_angle;
+	A_long					width;
+	A_long					height;
+	PF_Rect					extent_hint;
+	A_long					output_origin_x;
+	A_long					output_origin_y;
+	PF_RationalScale		downsample_x;
+	PF_RationalScale		downsample_y;
+	PF_RationalScale		pixel_aspect_ratio;
+	A_long					in_flags;
+	PF_Handle				global_data;
+	PF_Handle				sequence_data;
+	PF_Handle				frame_data;
+	A_long					start_sampL;
+	A_long					dur_sampL;
+	A_long					total_sampL;
+	struct SPBasicSuite		*pica_basicP;
+	A_long					pre_effect_source_origin_x;
+	A_long					pre_effect_source_origin_y;
+	PF_Fixed				shutter_phase;
+} PF_InData;
+
+typedef struct PF_OutData {
+	A_u_long		my_version;
+	A_char			name[32];
+	PF_Handle		global_data;
+	A_long			num_params;
+	PF_Handle		sequence_data;
+	A_long			flat_sdata_size;
+	PF_Handle		frame_data;
+	A_long			width;
+	A_long			height;
+	PF_Rect			origin;
+	A_long			out_flags;
+	A_char			return_msg[PF_MAX_EFFECT_MSG_LEN + 1];
+	A_long			start_sampL;
+	A_long			dur_sampL;
+	A_long			dest_snd;
+	A_long			out_flags2;
+} PF_OutData;
+
+
+/* SmartFX */
+
+typedef A_long PF_ChannelMask;
+
+enum {
+	PF_ChannelMask_ALPHA = 0x1,
+	PF_ChannelMask_RED = 0x2,
+	PF_ChannelMask_GREEN = 0x4,
+	PF_ChannelMask_BLUE = 0x8,
+	PF_ChannelMask_ARGB = 0xF
+};
+
+typedef struct {
+	PF_LRect		rect;
+	A_long			field;
+	PF_ChannelMask	channel_mask;
+	A_Boolean		preserve_rgb_of_zero_alpha;
+	A_char			unused[3];
+	A_long			reserved[4];
+} PF_RenderRequest;
+
+typedef struct {
+	PF_LRect			result_rect;
+	PF_LRect			max_result_rect;
+	PF_RationalScale	par;
+	A_long				solid;
+	A_Boolean			reservedB[3];
+	A_long				ref_width;
+	A_long				ref_height;
+	A_long				reserved[6];
+} PF_CheckoutResult;
+
+typedef void (*PF_DeletePreRenderDataFunc)(void *pre_render_data);
+
+typedef struct {
+	PF_RenderRequest	output_request;
+	short				bitdepth;
+	const void			*gpu_data;
+	A_long				what_gpu;
+	A_u_long			device_index;
+} PF_PreRenderInput;
+
+typedef struct {
+	PF_LRect					result_rect;
+	PF_LRect					max_result_rect;
+	A_Boolean					solid;
+	A_Boolean					reserved;
+	A_long						flags;
+	void						*pre_render_data;
+	PF_DeletePreRenderDataFunc	delete_pre_render_data_func;
+} PF_PreRenderOutput;
+
+typedef struct {
+	PF_Err (*checkout_layer)(PF_ProgPtr effect_ref, PF_ParamIndex index, A_long checkout_idL, const PF_RenderRequest *req, A_long what_time, A_long time_step, A_u_long time_scale, PF_CheckoutResult *checkout_result);
+	PF_Err (*GuidMixInPtr)(PF_ProgPtr effect_ref, A_u_long buf_sizeLu, const void *buf);
+} PF_PreRenderCallbacks;
+
+typedef struct {
+	PF_PreRenderInput		*input;
+	PF_PreRenderOutput		*output;
+	PF_PreRenderCallbacks	*cb;
+} PF_PreRenderExtra;
+
+typedef struct {
+	PF_RenderRequest	output_request;
+	short				bitdepth;
+	void				*pre_render_data;
+	const void			*gpu_data;
+	A_long				what_gpu;
+	A_u_long			device_index;
+} PF_SmartRenderInput;
+
+typedef struct {
+	PF_Err (*checkout_layer_pixels)(PF_ProgPtr effect_ref, A_long checkout_idL, PF_EffectWorld **pixels);
+	PF_Err (*checkin_layer_pixels)(PF_ProgPtr effect_ref, A_long checkout_idL);
+	PF_Err (*checkout_output)(PF_ProgPtr effect_ref, PF_EffectWorld **output);
+} PF_SmartRenderCallbacks;
+
+typedef struct {
+	PF_SmartRenderInput		*input;
+	PF_SmartRenderCallbacks	*cb;
+} PF_SmartRenderExtra;
+
+
+/* Registration */
+
+typedef void *PF_PluginDataPtr;
+typedef PF_Err (*PF_PluginDataCB)(PF_PluginDataPtr inPtr, const A_u_char *inNameZ, const A_u_char *inMatchNameZ, const A_u_char *inCategoryZ, const A_u_char *inEntryPointNameZ, A_long inType, A_long inAPIVersionMajor, A_long inAPIVersionMinor, A_long inReservedInfo);
+
+#define AE_RESERVED_INFO	8
+
+#define PF_REGISTER_EFFECT(INPTR, CBPTR, NAME, MATCHNAME, CATEGORY, RESERVEDINFO) \
+	(*(CBPTR))((INPTR), reinterpret_cast<const A_u_char*>(NAME), reinterpret_cast<const A_u_char*>(MATCHNAME), reinterpret_cast<const A_u_char*>(CATEGORY), reinterpret_cast<const A_u_char*>("EffectMain"), 'eFKT', PF_PLUG_IN_VERSION, PF_PLUG_IN_SUBVERS, (RESERVEDINFO))
+
+#endif // MOCK_AE_EFFECT_H
@@ -0,0 +1,78 @@
+/*
+	AE_EffectCB.h
+
+	Harness stand-in for the AE SDK utility callbacks and the macros that
+	wrap them.
+*/
+
+#pragma once
+
+#ifndef MOCK_AE_EFFECT_CB_H
+#define MOCK_AE_EFFECT_CB_H
+
+#include "AE_Effect.h"
+#include "SPBasic.h"
+
+enum {
+	PF_PlatData_MAIN_WND = 0,
+	PF_PlatData_EXE_FILE_PATH_DEPRECATED,
+	PF_PlatData_RES_FILE_PATH_DEPRECATED,
+	PF_PlatData_RES_REFNUM,
+	PF_PlatData_RES_DLLINSTANCE,
+	PF_PlatData_SP_PLUG_REF,
+	PF_PlatData_BUNDLE_REF,
+	PF_PlatData_EXE_FILE_PATH_W,
+	PF_PlatData_RES_FILE_PATH_W
+};
+
+#define AEFX_MAX_PATH	260
+
+typedef struct {
+	A_long (*sprintf)(A_char *buffer, const A_char *format, ...);
+} PF_ANSICallbacks;
+
+typedef struct _PF_UtilCallbacks {
+	PF_Handle (*host_new_handle)(A_u_long size);
+	void *(*host_lock_handle)(PF_Handle pf_handle);
+	void (*host_unlock_handle)(PF_Handle pf_handle);
+	void (*host_dispose_handle)(PF_Handle pf_handle);
+	PF_Err (*get_platform_data)(PF_ProgPtr effect_ref, A_long which, void *data);
+	PF_Err (*get_pixel_data8)(PF_EffectWorld *worldP, PF_Pixel *pixelsP0, PF_Pixel8 **pixPP);
+	PF_Err (*get_pixel_data16)(PF_EffectWorld *worldP, PF_Pixel *pixelsP0, PF_Pixel16 **pixPP);
+	PF_Err (*get_pixel_data_float)(PF_EffectWorld *worldP, PF_Pixel *pixelsP0, PF_PixelFloat **pixPP);
+	PF_ANSICallbacks	ansi;
+} PF_UtilCallbacks;
+
+#define PF_CHECKOUT_PARAM(IN_DATA, INDEX, TIME, STEP, SCALE, PARAM) \
+	(*(IN_DATA)->inter.checkout_param)((IN_DATA)->effect_ref, (INDEX), (TIME), (STEP), (SCALE), (PARAM))
+
+#define PF_CHECKIN_PARAM(IN_DATA, PARAM) \
+	(*(IN_DATA)->inter.checkin_param)((IN_DATA)->effect_ref, (PARAM))
+
+#define PF_ADD_PARAM(IN_DATA, INDEX, DEF) \
+	(*(IN_DATA)->inter.add_param)((IN_DATA)->effect_ref, (INDEX), (DEF))
+
+#define PF_ABORT(IN_DATA) \
+	(*(IN_DATA)->inter.abort)((IN_DATA)->effect_ref)
+
+#define PF_PROGRESS(IN_DATA, CURRENT, TOTAL) \
+	(*(IN_DATA)->inter.progress)((IN_DATA)->effect_ref, (CURRENT), (TOTAL))
+
+#define PF_NEW_HANDLE(SIZE)				(*in_data->utils->host_new_handle)((SIZE))
+#define PF_LOCK_HANDLE(PF_HANDLE)		(*in_data->utils->host_lock_handle)((PF_Handle)(PF_HANDLE))
+#define PF_UNLOCK_HANDLE(PF_HANDLE)		(*in_data->utils->host_unlock_handle)((PF_Handle)(PF_HANDLE))
+#define PF_DISPOSE_HANDLE(PF_HANDLE)	(*in_data->utils->host_dispose_handle)((PF_Handle)(PF_HANDLE))
+
+#define PF_GET_PLATFORM_DATA(PF_WHICH, PF_DATA_PTR) \
+	(*in_data->utils->get_platform_data)(in_data->effect_ref, (PF_WHICH), (PF_DATA_PTR))
+
+#define PF_GET_PIXEL_DATA8(WORLD, PIXEL_P0, RESULT_PP) \
+	(*in_data->utils->get_pixel_data8)((WORLD), (PIXEL_P0), (RESULT_PP))
+#define PF_GET_PIXEL_DATA16(WORLD, PIXEL_P0, RESULT_PP) \
+	(*in_data->utils->get_pixel_data16)((WORLD), (PIXEL_P0), (RESULT_PP))
+#define PF_GET_PIXEL_DATA_FLOAT(WORLD, PIXEL_P0, RESULT_PP) \
+	(*in_data->utils->get_pixel_data_float)((WORLD), (PIXEL_P0), (RESULT_PP))
+
+#define PF_SPRINTF	(*in_data->utils->ansi.sprintf)
+
+#endif // MOCK_AE_EFFECT_CB_H
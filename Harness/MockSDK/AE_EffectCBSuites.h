@@ -0,0 +1,71 @@
+/*
+	AE_EffectCBSuites.h
+
+	Harness stand-in for the PF suites DepthWaves acquires.
+*/
+
+#pragma once
+
+#ifndef MOCK_AE_EFFECT_CB_SUITES_H
+#define MOCK_AE_EFFECT_CB_SUITES_H
+
+#include "AE_Effect.h"
+
+#define kPFHandleSuite				"PF Handle Suite"
+#define kPFHandleSuiteVersion1		1
+
+typedef struct PF_HandleSuite1 {
+	PF_Handle (*host_new_handle)(A_u_long size);
+	void *(*host_lock_handle)(PF_Handle pf_handle);
+	void (*host_unlock_handle)(PF_Handle pf_handle);
+	void (*host_dispose_handle)(PF_Handle pf_handle);
+	A_u_long (*host_get_handle_size)(PF_Handle pf_handle);
+	PF_Err (*host_resize_handle)(A_u_long new_sizeL, PF_Handle *handlePH);
+} PF_HandleSuite1;
+
+#define kPFANSISuite				"PF ANSI Suite"
+#define kPFANSISuiteVersion1		1
+
+typedef struct PF_ANSICallbacksSuite1 {
+	A_long (*sprintf)(A_char *buffer, const A_char *format, ...);
+} PF_ANSICallbacksSuite1;
+
+#define kPFIterateFloatSuite		"PF Iterate Float Suite"
+#define kPFIterateFloatSuiteVersion1	1
+
+typedef struct PF_IterateFloatSuite1 {
+	PF_Err (*iterate)(
+		PF_InData		*in_data,
+		A_long			progress_base,
+		A_long			progress_final,
+		PF_EffectWorld	*src,
+		const PF_Rect	*area,
+		void			*refcon,
+		PF_Err			(*pix_fn)(void *refcon, A_long x, A_long y, PF_PixelFloat *in, PF_PixelFloat *out),
+		PF_EffectWorld	*dst);
+} PF_IterateFloatSuite1;
+
+#define kPFWorldSuite				"PF World Suite"
+#define kPFWorldSuiteVersion2		2
+
+typedef struct PF_WorldSuite2 {
+	PF_Err (*PF_NewWorld)(PF_ProgPtr effect_ref, A_long widthL, A_long heightL, A_Boolean clear_pixB, PF_PixelFormat pixel_format, PF_EffectWorld *worldP);
+	PF_Err (*PF_DisposeWorld)(PF_ProgPtr effect_ref, PF_EffectWorld *worldP);
+	PF_Err (*PF_GetPixelFormat)(const PF_EffectWorld *worldP, PF_PixelFormat *pixel_formatP);
+} PF_WorldSuite2;
+
+#define kPFParamUtilsSuite			"PF Param Utils Suite"
+#define kPFParamUtilsSuiteVersion3	3
+
+typedef struct PF_ParamUtilsSuite3 {
+	PF_Err (*PF_UpdateParamUI)(PF_ProgPtr effect_ref, PF_ParamIndex param_index, const PF_ParamDef *defP);
+	PF_Err (*PF_GetCurrentState)(PF_ProgPtr effect_ref, PF_ParamIndex param_index, const A_Time *startPT0, const A_Time *durationPT0, void *stateP);
+	PF_Err (*PF_AreStatesIdentical)(PF_ProgPtr effect_ref, const void *state1P, const void *state2P, A_Boolean *samePB);
+	PF_Err (*PF_IsIdenticalCheckout)(PF_ProgPtr effect_ref, PF_ParamIndex param_index, A_long what_time1, A_long time_step1, A_u_long time_scale1, A_long what_time2, A_long time_step2, A_u_long time_scale2, A_Boolean *identicalPB);
+	PF_Err (*PF_FindKeyframeTime)(PF_ProgPtr effect_ref, PF_ParamIndex param_index, A_long what_time, A_u_long time_scale, A_long time_dir, A_Boolean *foundPB, PF_KeyIndex *key_indexP0, A_long *key_timeP0, A_u_long *key_timescaleP0);
+	PF_Err (*PF_GetKeyframeCount)(PF_ProgPtr effect_ref, PF_ParamIndex param_index, PF_KeyIndex *key_countP);
+	PF_Err (*PF_CheckoutKeyframe)(PF_ProgPtr effect_ref, PF_ParamIndex param_index, PF_KeyIndex key_index, A_long *key_timeP0, A_u_long *key_timescaleP0, PF_ParamDef *paramP0);
+	PF_Err (*PF_CheckinKeyframe)(PF_ProgPtr effect_ref, PF_ParamDef *paramP);
+} PF_ParamUtilsSuite3;
+
+#endif // MOCK_AE_EFFECT_CB_SUITES_H
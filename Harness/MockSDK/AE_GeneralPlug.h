@@ -0,0 +1,78 @@
+/*
+	AE_GeneralPlug.h
+
+	Harness stand-in for the AEGP types and suites DepthWaves uses to read
+	the comp camera.
+*/
+
+#pragma once
+
+#ifndef MOCK_AE_GENERAL_PLUG_H
+#define MOCK_AE_GENERAL_PLUG_H
+
+#include "AE_Effect.h"
+
+typedef struct _AEGP_Layer	*AEGP_LayerH;
+typedef struct _AEGP_Effect	*AEGP_EffectRefH;
+
+typedef A_long AEGP_LayerStream;
+
+enum {
+	AEGP_LayerStream_ANCHORPOINT = 0,
+	AEGP_LayerStream_POSITION,
+	AEGP_LayerStream_SCALE,
+	AEGP_LayerStream_ROTATION,
+	AEGP_LayerStream_ROTATE_Z = AEGP_LayerStream_ROTATION,
+	AEGP_LayerStream_OPACITY,
+	AEGP_LayerStream_AUDIO,
+	AEGP_LayerStream_MARKER,
+	AEGP_LayerStream_TIME_REMAP,
+	AEGP_LayerStream_ROTATE_X,
+	AEGP_LayerStream_ROTATE_Y,
+	AEGP_LayerStream_ORIENTATION,
+	AEGP_LayerStream_ZOOM
+};
+
+typedef A_long AEGP_LTimeMode;
+
+enum {
+	AEGP_LTimeMode_LayerTime = 0,
+	AEGP_LTimeMode_CompTime
+};
+
+typedef A_long AEGP_StreamType;
+
+typedef struct {
+	A_FpLong	x, y;
+} AEGP_TwoDVal;
+
+typedef struct {
+	A_FpLong	alphaF, redF, greenF, blueF;
+} AEGP_ColorVal;
+
+typedef union {
+	A_FloatPoint3	three_d;
+	AEGP_TwoDVal	two_d;
+	A_FpLong		one_d;
+	AEGP_ColorVal	color;
+} AEGP_StreamVal2;
+
+#define kPFInterfaceSuite			"PF AE Interface Suite"
+#define kPFInterfaceSuiteVersion1	1
+
+typedef struct PF_PFInterfaceSuite1 {
+	A_Err (*AEGP_GetEffectLayer)(PF_ProgPtr effect_ref, AEGP_LayerH *layerPH);
+	A_Err (*AEGP_GetNewEffectForEffect)(A_long aegp_plugin_id, PF_ProgPtr effect_ref, AEGP_EffectRefH *effectPH);
+	A_Err (*AEGP_ConvertEffectToCompTime)(PF_ProgPtr effect_ref, A_long what_timeL, A_u_long time_scaleLu, A_Time *comp_timePT);
+	A_Err (*AEGP_GetEffectCamera)(PF_ProgPtr effect_ref, const A_Time *comp_timePT, AEGP_LayerH *camera_layerPH);
+	A_Err (*AEGP_GetEffectCameraMatrix)(PF_ProgPtr effect_ref, const A_Time *comp_timePT, A_Matrix4 *camera_matrixP, A_FpLong *dst_to_planePF, A_short *plane_widthPL, A_short *plane_heightPL);
+} PF_PFInterfaceSuite1;
+
+#define kAEGPStreamSuite			"AEGP Stream Suite"
+#define kAEGPStreamSuiteVersion5	5
+
+typedef struct AEGP_StreamSuite5 {
+	A_Err (*AEGP_GetLayerStreamValue)(AEGP_LayerH layerH, AEGP_LayerStream which_stream, AEGP_LTimeMode time_mode, const A_Time *timePT, A_Boolean pre_expressionB, AEGP_StreamVal2 *stream_valP, AEGP_StreamType *stream_typeP0);
+} AEGP_StreamSuite5;
+
+#endif // MOCK_AE_GENERAL_PLUG_H
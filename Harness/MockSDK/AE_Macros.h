@@ -0,0 +1,27 @@
+/*
+	AE_Macros.h
+
+	Harness stand-in for the SDK's error-chaining and struct helpers.
+*/
+
+#pragma once
+
+#ifndef MOCK_AE_MACROS_H
+#define MOCK_AE_MACROS_H
+
+#include <string.h>
+
+#define ERR(FUNC)	do { if (!err) { err = (FUNC); } } while (0)
+#define ERR2(FUNC)	do { if (((err2 = (FUNC)) != A_Err_NONE) && !err) err = err2; } while (0)
+
+#define AEFX_CLR_STRUCT(STRUCT) \
+	do { \
+		A_long _t = sizeof(STRUCT); \
+		char *_p = (char*)&(STRUCT); \
+		while (_t--) { *_p++ = 0; } \
+	} while (0)
+
+#define PF_STRCPY(DST, SRC) \
+	do { strncpy((DST), (SRC), sizeof(DST) - 1); (DST)[sizeof(DST) - 1] = 0; } while (0)
+
+#endif // MOCK_AE_MACROS_H
@@ -0,0 +1,80 @@
+/*
+	Param_Utils.h
+
+	Harness stand-in for the SDK's parameter registration macros. Like the
+	real ones, they expect `def`, `err` and `in_data` in scope.
+*/
+
+#pragma once
+
+#ifndef MOCK_PARAM_UTILS_H
+#define MOCK_PARAM_UTILS_H
+
+#include "AE_EffectCB.h"
+#include "AE_Macros.h"
+
+#define PF_ADD_LAYER(NAME, DFLT, ID) \
+	do { \
+		AEFX_CLR_STRUCT(def); \
+		def.param_type = PF_Param_LAYER; \
+		PF_STRCPY(def.name, (NAME)); \
+		def.u.ld.dephault = (DFLT); \
+		def.uu.id = (ID); \
+		if ((err = PF_ADD_PARAM(in_data, -1, &def)) != PF_Err_NONE) return err; \
+	} while (0)
+
+#define PF_ADD_CHECKBOXX(NAME, DFLT, FLAGS, ID) \
+	do { \
+		AEFX_CLR_STRUCT(def); \
+		def.param_type = PF_Param_CHECKBOX; \
+		PF_STRCPY(def.name, (NAME)); \
+		def.u.bd.value = def.u.bd.dephault = (DFLT); \
+		def.flags = (FLAGS); \
+		def.uu.id = (ID); \
+		if ((err = PF_ADD_PARAM(in_data, -1, &def)) != PF_Err_NONE) return err; \
+	} while (0)
+
+#define PF_ADD_POINT_3D(NAME, X_DFLT, Y_DFLT, Z_DFLT, ID) \
+	do { \
+		AEFX_CLR_STRUCT(def); \
+		def.param_type = PF_Param_POINT_3D; \
+		PF_STRCPY(def.name, (NAME)); \
+		def.u.point3d_d.x_value = def.u.point3d_d.x_dephault = (X_DFLT); \
+		def.u.point3d_d.y_value = def.u.point3d_d.y_dephault = (Y_DFLT); \
+		def.u.point3d_d.z_value = def.u.point3d_d.z_dephault = (Z_DFLT); \
+		def.uu.id = (ID); \
+		if ((err = PF_ADD_PARAM(in_data, -1, &def)) != PF_Err_NONE) return err; \
+	} while (0)
+
+#define PF_ADD_FLOAT_SLIDERX(NAME, VALID_MIN, VALID_MAX, SLIDER_MIN, SLIDER_MAX, DFLT, PREC, DISP, FLAGS, ID) \
+	do { \
+		AEFX_CLR_STRUCT(def); \
+		def.param_type = PF_Param_FLOAT_SLIDER; \
+		PF_STRCPY(def.name, (NAME)); \
+		def.u.fs_d.valid_min = (PF_FpShort)(VALID_MIN); \
+		def.u.fs_d.valid_max = (PF_FpShort)(VALID_MAX); \
+		def.u.fs_d.slider_min = (PF_FpShort)(SLIDER_MIN); \
+		def.u.fs_d.slider_max = (PF_FpShort)(SLIDER_MAX); \
+		def.u.fs_d.value = (DFLT); \
+		def.u.fs_d.dephault = (PF_FpShort)(DFLT); \
+		def.u.fs_d.precision = (PREC); \
+		def.u.fs_d.display_flags = (DISP); \
+		def.flags = (FLAGS); \
+		def.uu.id = (ID); \
+		if ((err = PF_ADD_PARAM(in_data, -1, &def)) != PF_Err_NONE) return err; \
+	} while (0)
+
+#define PF_ADD_COLOR(NAME, RED, GREEN, BLUE, ID) \
+	do { \
+		AEFX_CLR_STRUCT(def); \
+		def.param_type = PF_Param_COLOR; \
+		PF_STRCPY(def.name, (NAME)); \
+		def.u.cd.value.red = def.u.cd.dephault.red = (RED); \
+		def.u.cd.value.green = def.u.cd.dephault.green = (GREEN); \
+		def.u.cd.value.blue = def.u.cd.dephault.blue = (BLUE); \
+		def.u.cd.value.alpha = def.u.cd.dephault.alpha = 255; \
+		def.uu.id = (ID); \
+		if ((err = PF_ADD_PARAM(in_data, -1, &def)) != PF_Err_NONE) return err; \
+	} while (0)
+
+#endif // MOCK_PARAM_UTILS_H
@@ -0,0 +1,20 @@
+/*
+	SPBasic.h
+
+	Harness stand-in for the PICA basic suite, through which every other
+	suite is acquired.
+*/
+
+#pragma once
+
+#ifndef MOCK_SP_BASIC_H
+#define MOCK_SP_BASIC_H
+
+#include "A.h"
+
+typedef struct SPBasicSuite {
+	A_Err (*AcquireSuite)(const char *name, A_long version, const void **suite);
+	A_Err (*ReleaseSuite)(const char *name, A_long version);
+} SPBasicSuite;
+
+#endif // MOCK_SP_BASIC_H
@@ -0,0 +1,32 @@
+/*
+	Smart_Utils.h
+
+	Harness stand-in for the SDK's SmartFX rectangle helpers.
+*/
+
+#pragma once
+
+#ifndef MOCK_SMART_UTILS_H
+#define MOCK_SMART_UTILS_H
+
+#include "AE_Effect.h"
+
+inline A_Boolean IsEmptyRect(const PF_LRect *r)
+{
+	return (r->left >= r->right) || (r->top >= r->bottom);
+}
+
+inline void UnionLRect(const PF_LRect *src, PF_LRect *dst)
+{
+	if (IsEmptyRect(dst)) {
+		*dst = *src;
+	}
+	else if (!IsEmptyRect(src)) {
+		dst->left = src->left < dst->left ? src->left : dst->left;
+		dst->top = src->top < dst->top ? src->top : dst->top;
+		dst->right = src->right > dst->right ? src->right : dst->right;
+		dst->bottom = src->bottom > dst->bottom ? src->bottom : dst->bottom;
+	}
+}
+
+#endif // MOCK_SMART_UTILS_H
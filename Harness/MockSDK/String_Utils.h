@@ -0,0 +1,16 @@
+/*
+	String_Utils.h
+
+	Harness stand-in for the SDK's string table accessor.
+*/
+
+#pragma once
+
+#ifndef MOCK_STRING_UTILS_H
+#define MOCK_STRING_UTILS_H
+
+char *GetStringPtr(int strNum);
+
+#define STR(_foo)	GetStringPtr(_foo)
+
+#endif // MOCK_STRING_UTILS_H
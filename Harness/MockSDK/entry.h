@@ -0,0 +1,14 @@
+/*
+	entry.h
+
+	Harness stand-in for the AE SDK entry point declarations.
+*/
+
+#pragma once
+
+#ifndef MOCK_ENTRY_H
+#define MOCK_ENTRY_H
+
+#define DllExport	__attribute__((visibility("default")))
+
+#endif // MOCK_ENTRY_H
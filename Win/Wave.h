@@ -4,6 +4,8 @@
 
 #include "glbinding/gl45core/gl.h"
 
+#include <string.h>
+
 struct Wave {
 	gl::GLfloat position[4];
 	gl::GLfloat displacement[4];
@@ -15,9 +17,8 @@ struct Wave {
 	gl::GLfloat innerRadius;
 
 	gl::GLfloat timeSinceBirth;
-	gl::GLfloat padding[3];
 	
-	Wave() : position(), displacement(), color(), blockSizeMultiplier(), colorMix(), outerRadius(), innerRadius(), timeSinceBirth(), padding() {};
+	Wave() : position(), displacement(), color(), blockSizeMultiplier(), colorMix(), outerRadius(), innerRadius(), timeSinceBirth() {};
 
 	Wave(
 		gl::GLfloat position[4],